@@ -18,9 +18,11 @@
  */
 
 #include "plugin.h"
+#include "bytesiconprovider.h"
 #include "qmenumodel.h"
 #include "qdbusmenumodel.h"
 #include "qdbusactiongroup.h"
+#include "qdbusactionlistmodel.h"
 #include "qstateaction.h"
 #include "unitymenuaction.h"
 #include "unitymenumodel.h"
@@ -29,6 +31,10 @@
 
 void QMenuModelQmlPlugin::initializeEngine(QQmlEngine *engine, const char *uri)
 {
+    // serves the image data of menu item icons sent as GBytesIcon
+    if (!engine->imageProvider(BytesIconProvider::providerId)) {
+        engine->addImageProvider(BytesIconProvider::providerId, new BytesIconProvider);
+    }
 }
 
 void QMenuModelQmlPlugin::registerTypes(const char *uri)
@@ -37,6 +43,8 @@ void QMenuModelQmlPlugin::registerTypes(const char *uri)
                                            "QMenuModel is a interface");
     qmlRegisterUncreatableType<QStateAction>(uri, 0, 1, "QStateAction",
                                              "QStateAction must be created by QDBusActionGroup::action");
+    qmlRegisterUncreatableType<QDBusActionListModel>(uri, 0, 1, "QDBusActionListModel",
+                                                     "QDBusActionListModel must be obtained from QDBusActionGroup::actionsModel");
     qmlRegisterUncreatableType<DBusEnums>(uri, 0, 1, "DBus",
                                           "DBus is only a namespace");
 
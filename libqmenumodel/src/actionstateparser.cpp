@@ -20,15 +20,196 @@
 #include "actionstateparser.h"
 #include "converter.h"
 
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+extern "C" {
+#include <glib.h>
+}
+
+struct ActionConverter
+{
+    GPatternSpec *pattern;
+    ActionStateParser::StateConverter converter;
+};
+
+struct StateConverterRegistry
+{
+    ~StateConverterRegistry()
+    {
+        Q_FOREACH(const ActionConverter &entry, actionConverters) {
+            g_pattern_spec_free(entry.pattern);
+        }
+    }
+
+    QMutex mutex;
+    QHash<QByteArray, ActionStateParser::StateConverter> typeConverters;
+    QVector<ActionConverter> actionConverters;
+};
+
+Q_GLOBAL_STATIC(StateConverterRegistry, stateConverterRegistry)
+
 ActionStateParser::ActionStateParser(QObject* parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_native(false)
+{
+}
+
+ActionStateParser::ActionStateParser(Conversion)
+    : QObject(0),
+      m_native(true)
 {
 }
 
 QVariant ActionStateParser::toQVariant(GVariant* state) const
 {
     if (state) {
+        StateConverter converter = registeredConverter(NULL, state);
+        if (converter) {
+            return converter(state);
+        }
         return Converter::toQVariant(state);
     }
     return QVariant();
-}
\ No newline at end of file
+}
+
+QVariant ActionStateParser::parseState(const char *actionName, GVariant *state,
+                                       GVariant *previous, const QVariant &previousResult) const
+{
+    if (!state) {
+        return QVariant();
+    } else if (!isNative()) {
+        return toQVariant(state);
+    }
+
+    StateConverter converter = registeredConverter(actionName, state);
+    if (converter) {
+        return converter(state);
+    } else if (previous) {
+        return Converter::toQVariantWithPrevious(state, previous, previousResult);
+    }
+    return Converter::toQVariant(state);
+}
+
+bool ActionStateParser::isNative() const
+{
+    return m_native;
+}
+
+void ActionStateParser::registerTypeConverter(const QByteArray &typeString, StateConverter converter)
+{
+    StateConverterRegistry *registry = stateConverterRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    registry->typeConverters.insert(typeString, converter);
+}
+
+void ActionStateParser::registerActionConverter(const QByteArray &actionPattern, StateConverter converter)
+{
+    StateConverterRegistry *registry = stateConverterRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    ActionConverter entry;
+    entry.pattern = g_pattern_spec_new(actionPattern.constData());
+    entry.converter = converter;
+    registry->actionConverters << entry;
+}
+
+ActionStateParser* ActionStateParser::sharedParser()
+{
+    static ActionStateParser parser(NativeConversion);
+    return &parser;
+}
+
+ActionStateParser::StateConverter ActionStateParser::registeredConverter(const char *actionName, GVariant *state)
+{
+    StateConverterRegistry *registry = stateConverterRegistry();
+    QMutexLocker locker(&registry->mutex);
+
+    if (actionName) {
+        Q_FOREACH(const ActionConverter &entry, registry->actionConverters) {
+            if (g_pattern_match_string(entry.pattern, actionName)) {
+                return entry.converter;
+            }
+        }
+    }
+
+    if (registry->typeConverters.isEmpty()) {
+        return NULL;
+    }
+
+    const gchar *typeString = g_variant_get_type_string(state);
+    return registry->typeConverters.value(QByteArray::fromRawData(typeString, qstrlen(typeString)));
+}
+
+template<>
+bool ActionStateParser::stateValue<bool>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_BOOLEAN) && g_variant_get_boolean(state);
+}
+
+template<>
+qint32 ActionStateParser::stateValue<qint32>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_INT32) ? g_variant_get_int32(state) : 0;
+}
+
+template<>
+quint32 ActionStateParser::stateValue<quint32>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_UINT32) ? g_variant_get_uint32(state) : 0;
+}
+
+template<>
+qint64 ActionStateParser::stateValue<qint64>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_INT64) ? g_variant_get_int64(state) : 0;
+}
+
+template<>
+quint64 ActionStateParser::stateValue<quint64>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_UINT64) ? g_variant_get_uint64(state) : 0;
+}
+
+template<>
+double ActionStateParser::stateValue<double>(GVariant *state)
+{
+    return g_variant_is_of_type(state, G_VARIANT_TYPE_DOUBLE) ? g_variant_get_double(state) : 0.0;
+}
+
+template<>
+QString ActionStateParser::stateValue<QString>(GVariant *state)
+{
+    if (!g_variant_is_of_type(state, G_VARIANT_TYPE_STRING)) {
+        return QString();
+    }
+
+    gsize size = 0;
+    const gchar *value = g_variant_get_string(state, &size);
+    return QString::fromUtf8(value, size);
+}
+
+template<>
+QStringList ActionStateParser::stateValue<QStringList>(GVariant *state)
+{
+    QStringList list;
+
+    if (g_variant_is_of_type(state, G_VARIANT_TYPE_STRING_ARRAY)) {
+        gsize size = 0;
+        const gchar **strv = g_variant_get_strv(state, &size);
+        for (gsize i = 0; i < size; ++i) {
+            list << QString::fromUtf8(strv[i]);
+        }
+        g_free(strv);
+    }
+    return list;
+}
+
+template<>
+QVariantMap ActionStateParser::stateValue<QVariantMap>(GVariant *state)
+{
+    return Converter::toQVariant(state).toMap();
+}
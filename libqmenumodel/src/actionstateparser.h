@@ -21,6 +21,7 @@
 #define ACTIONSTATEPARSER_H
 
 #include <QObject>
+#include <QStringList>
 #include <QVariant>
 
 typedef struct _GVariant GVariant;
@@ -29,9 +30,75 @@ class ActionStateParser : public QObject
 {
     Q_OBJECT
 public:
+    typedef QVariant (*StateConverter)(GVariant *state);
+
     ActionStateParser(QObject* parent = 0);
 
     virtual QVariant toQVariant(GVariant* state) const;
+
+    // Converts the state of the action actionName. Parsers convert with
+    // toQVariant, except for the shared parser which uses the converters
+    // registered for the action or the type of the state, and otherwise
+    // reuses the unchanged entries of previousResult when given the state it
+    // was converted from.
+    QVariant parseState(const char *actionName, GVariant *state,
+                        GVariant *previous = NULL, const QVariant &previousResult = QVariant()) const;
+
+    // True for the shared parser, which converts natively.
+    bool isNative() const;
+
+    // Native converters shared by every plain ActionStateParser. Converters
+    // registered for an action name pattern (see g_pattern_match_simple) are
+    // tried before the ones registered for the type string of the state.
+    static void registerTypeConverter(const QByteArray &typeString, StateConverter converter);
+    static void registerActionConverter(const QByteArray &actionPattern, StateConverter converter);
+
+    template<typename T>
+    static void registerTypeConverter(const QByteArray &typeString)
+    {
+        registerTypeConverter(typeString, &ActionStateParser::convertState<T>);
+    }
+
+    template<typename T>
+    static void registerActionConverter(const QByteArray &actionPattern)
+    {
+        registerActionConverter(actionPattern, &ActionStateParser::convertState<T>);
+    }
+
+    // One plain parser for every model and action group that has no parser
+    // of its own.
+    static ActionStateParser* sharedParser();
+
+    // Reads a state as T, specialised for bool, qint32, quint32, qint64,
+    // quint64, double, QString, QStringList and QVariantMap.
+    template<typename T>
+    static T stateValue(GVariant *state);
+
+    template<typename T>
+    static QVariant convertState(GVariant *state)
+    {
+        return QVariant::fromValue(stateValue<T>(state));
+    }
+
+private:
+    enum Conversion { NativeConversion };
+    explicit ActionStateParser(Conversion conversion);
+
+    static StateConverter registeredConverter(const char *actionName, GVariant *state);
+
+    // set by the constructor of the shared parser only, parsers created
+    // elsewhere may override toQVariant
+    bool m_native;
 };
 
+template<> bool ActionStateParser::stateValue<bool>(GVariant *state);
+template<> qint32 ActionStateParser::stateValue<qint32>(GVariant *state);
+template<> quint32 ActionStateParser::stateValue<quint32>(GVariant *state);
+template<> qint64 ActionStateParser::stateValue<qint64>(GVariant *state);
+template<> quint64 ActionStateParser::stateValue<quint64>(GVariant *state);
+template<> double ActionStateParser::stateValue<double>(GVariant *state);
+template<> QString ActionStateParser::stateValue<QString>(GVariant *state);
+template<> QStringList ActionStateParser::stateValue<QStringList>(GVariant *state);
+template<> QVariantMap ActionStateParser::stateValue<QVariantMap>(GVariant *state);
+
 #endif // ACTIONSTATEPARSER_H
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C" {
+#include <glib.h>
+}
+
+#include "bytesiconprovider.h"
+
+#include <QCache>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+
+// total size of the image data kept for uris nobody holds anymore
+static const int MaxStoreSize = 32 * 1024 * 1024;
+
+const char *BytesIconProvider::providerId = "qmenumodel-bytes";
+
+struct BytesIconEntry
+{
+    BytesIconEntry(GBytes *_bytes) : bytes(g_bytes_ref(_bytes)), refs(0) {}
+    ~BytesIconEntry() { g_bytes_unref(bytes); }
+
+    int cost() const { return (int) qBound<gsize>(1, g_bytes_get_size(bytes), MaxStoreSize + 1); }
+
+    GBytes *bytes;
+    int refs;
+};
+
+struct BytesIconStore
+{
+    BytesIconStore() { released.setMaxCost(MaxStoreSize); }
+    ~BytesIconStore() { qDeleteAll(pinned); }
+
+    BytesIconEntry *find(const QByteArray &key)
+    {
+        BytesIconEntry *entry = pinned.value(key);
+        return entry ? entry : released.object(key);
+    }
+
+    QMutex mutex;
+    // entries with uris handed out by acquireUri, never evicted
+    QHash<QByteArray, BytesIconEntry*> pinned;
+    // entries nobody holds, evicted by size
+    QCache<QByteArray, BytesIconEntry> released;
+};
+
+Q_GLOBAL_STATIC(BytesIconStore, bytesIconStore)
+
+static QByteArray keyForBytes(GBytes *bytes)
+{
+    gsize length;
+    gconstpointer data = g_bytes_get_data(bytes, &length);
+
+    return QCryptographicHash::hash(QByteArray::fromRawData((const char *) data, length),
+                                    QCryptographicHash::Sha1).toHex();
+}
+
+static QString uriForKey(const QByteArray &key)
+{
+    return QString("image://%1/%2").arg(BytesIconProvider::providerId).arg(QString::fromLatin1(key));
+}
+
+/* Returns the key of a uri of this provider, or an empty key for other uris */
+static QByteArray keyForUri(const QString &uri)
+{
+    const QString prefix = QString("image://%1/").arg(BytesIconProvider::providerId);
+    if (!uri.startsWith(prefix))
+        return QByteArray();
+    return uri.mid(prefix.length()).toLatin1();
+}
+
+BytesIconProvider::BytesIconProvider()
+    : QQuickImageProvider(QQuickImageProvider::Image)
+{
+}
+
+QImage BytesIconProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    BytesIconStore *store = bytesIconStore();
+    GBytes *bytes = NULL;
+    QImage image;
+
+    store->mutex.lock();
+    BytesIconEntry *entry = store->find(id.toLatin1());
+    if (entry)
+        bytes = g_bytes_ref(entry->bytes);
+    store->mutex.unlock();
+
+    if (bytes == NULL)
+        return image;
+
+    gsize length;
+    gconstpointer data = g_bytes_get_data(bytes, &length);
+    image.loadFromData((const uchar *) data, length);
+    g_bytes_unref(bytes);
+
+    if (size)
+        *size = image.size();
+
+    if (!image.isNull() && requestedSize.isValid() && requestedSize != image.size())
+        image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    return image;
+}
+
+/* Returns a uri for @bytes without holding on to it. The uri stops resolving
+ * once the data is evicted from the store. */
+QString BytesIconProvider::uriForBytes(GBytes *bytes)
+{
+    BytesIconStore *store = bytesIconStore();
+    QByteArray key = keyForBytes(bytes);
+
+    store->mutex.lock();
+    if (!store->pinned.contains(key) && !store->released.contains(key)) {
+        BytesIconEntry *entry = new BytesIconEntry(bytes);
+        store->released.insert(key, entry, entry->cost());
+    }
+    store->mutex.unlock();
+
+    return uriForKey(key);
+}
+
+/* Returns a uri for @bytes that keeps resolving until it is passed to
+ * releaseUri() as often as it was acquired. */
+QString BytesIconProvider::acquireUri(GBytes *bytes)
+{
+    BytesIconStore *store = bytesIconStore();
+    QByteArray key = keyForBytes(bytes);
+
+    store->mutex.lock();
+    BytesIconEntry *entry = store->pinned.value(key);
+    if (!entry) {
+        entry = store->released.take(key);
+        if (!entry)
+            entry = new BytesIconEntry(bytes);
+        store->pinned.insert(key, entry);
+    }
+    entry->refs++;
+    store->mutex.unlock();
+
+    return uriForKey(key);
+}
+
+/* Releases a uri returned by acquireUri(). Other uris are ignored. */
+void BytesIconProvider::releaseUri(const QString &uri)
+{
+    BytesIconStore *store = bytesIconStore();
+    QByteArray key = keyForUri(uri);
+    if (key.isEmpty())
+        return;
+
+    store->mutex.lock();
+    BytesIconEntry *entry = store->pinned.value(key);
+    if (entry && --entry->refs == 0) {
+        store->pinned.remove(key);
+        // dropped right away if it is larger than the whole store
+        store->released.insert(key, entry, entry->cost());
+    }
+    store->mutex.unlock();
+}
+
+/* Whether the data behind @uri can still be served */
+bool BytesIconProvider::contains(const QString &uri)
+{
+    BytesIconStore *store = bytesIconStore();
+    QByteArray key = keyForUri(uri);
+    if (key.isEmpty())
+        return false;
+
+    QMutexLocker locker(&store->mutex);
+    return store->pinned.contains(key) || store->released.contains(key);
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BYTESICONPROVIDER_H
+#define BYTESICONPROVIDER_H
+
+#include <QQuickImageProvider>
+
+typedef struct _GBytes GBytes;
+
+/* Serves the image data of GBytesIcons to QML.
+ *
+ * The data is kept as a reference to the icon's GBytes and published under
+ * an "image://qmenumodel-bytes/<content hash>" uri, so identical payloads
+ * are stored once whatever row or model they come from. Payloads behind a
+ * uri from acquireUri() are kept, whatever their size, until the uri is
+ * released as often as it was acquired. Payloads nobody holds anymore are
+ * dropped least recently used first once they grow past the store's limit. */
+class BytesIconProvider : public QQuickImageProvider
+{
+public:
+    static const char *providerId;
+
+    BytesIconProvider();
+
+    virtual QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
+
+    static QString uriForBytes(GBytes *bytes);
+    static QString acquireUri(GBytes *bytes);
+    static void releaseUri(const QString &uri);
+    static bool contains(const QString &uri);
+};
+
+#endif // BYTESICONPROVIDER_H
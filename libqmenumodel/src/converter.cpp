@@ -24,9 +24,135 @@ extern "C" {
 
 #include "converter.h"
 
+#include <QCache>
 #include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
 #include <QString>
+#include <QStringList>
 #include <QVariant>
+#include <QVector>
+
+/*! \internal */
+template<typename T>
+static QVariantList fixedArrayToList(GVariant *value)
+{
+    gsize size = 0;
+    const T *data = static_cast<const T*>(g_variant_get_fixed_array(value, &size, sizeof(T)));
+
+    QVariantList list;
+    list.reserve(size);
+    for (gsize i = 0; i < size; ++i) {
+        list << QVariant::fromValue<T>(data[i]);
+    }
+    return list;
+}
+
+/*! \internal */
+template<typename T>
+static QVariant fixedArrayToVector(GVariant *value)
+{
+    gsize size = 0;
+    gconstpointer data = g_variant_get_fixed_array(value, &size, sizeof(T));
+
+    QVector<T> vector(size);
+    if (size > 0) {
+        memcpy(vector.data(), data, size * sizeof(T));
+    }
+    return QVariant::fromValue(vector);
+}
+
+/*! \internal */
+template<typename T>
+static GVariant* vectorToFixedArray(const QVariant &value, const GVariantType *elementType)
+{
+    const QVector<T> &vector = value.value<QVector<T> >();
+    return g_variant_new_fixed_array(elementType, vector.constData(), vector.size(), sizeof(T));
+}
+
+/*! \internal */
+static QVariant arrayToQVariant(GVariant *value, const gchar *typeString)
+{
+    QVariant result;
+
+    // the most common container signatures get their own conversions
+    switch (typeString[1]) {
+    case 's':
+        if (typeString[2] == '\0') {
+            gsize size = 0;
+            const gchar **sa = g_variant_get_strv(value, &size);
+            QStringList list;
+            for (gsize i = 0; i < size; ++i) {
+                list << QString::fromUtf8(sa[i]);
+            }
+            result.setValue(list);
+            g_free(sa);
+            return result;
+        }
+        break;
+    case 'y':
+        if (typeString[2] == '\0') {
+            result.setValue(QByteArray(g_variant_get_bytestring(value)));
+            return result;
+        }
+        break;
+    case 'a':
+        if (g_str_equal(typeString, "aay")) {
+            gsize size = 0;
+            const gchar **bsa = g_variant_get_bytestring_array(value, &size);
+            QByteArrayList list;
+            for (gsize i = 0; i < size; ++i) {
+                list << bsa[i];
+            }
+            result.setValue(list);
+            g_free(bsa);
+            return result;
+        }
+        break;
+    case '{':
+        if (g_str_equal(typeString, "a{sv}")) {
+            GVariantIter iter;
+            GVariant *vvalue;
+            gchar *key;
+            QVariantMap qmap;
+
+            g_variant_iter_init (&iter, value);
+            while (g_variant_iter_loop (&iter, "{sv}", &key, &vvalue))
+            {
+                qmap.insert(QString::fromUtf8(key), Converter::toQVariant(vvalue));
+            }
+
+            result.setValue(qmap);
+            return result;
+        }
+        break;
+    }
+
+    QVariantList lst;
+    switch (typeString[1]) {
+    // arrays of int and double are copied in one go to the QVector types QML
+    // reads as sequences
+    case 'i': return fixedArrayToVector<qint32>(value);
+    case 'd': return fixedArrayToVector<double>(value);
+    // arrays of other fixed size numbers are read in place instead of child by child
+    case 'n': lst = fixedArrayToList<qint16>(value); break;
+    case 'q': lst = fixedArrayToList<quint16>(value); break;
+    case 'u': lst = fixedArrayToList<quint32>(value); break;
+    case 'x': lst = fixedArrayToList<qint64>(value); break;
+    case 't': lst = fixedArrayToList<quint64>(value); break;
+    default:
+        for (int i = 0, iMax = g_variant_n_children(value); i < iMax; i++) {
+            GVariant *child = g_variant_get_child_value(value, i);
+            lst << Converter::toQVariant(child);
+            g_variant_unref(child);
+        }
+        break;
+    }
+    result.setValue(lst);
+
+    return result;
+}
 
 /*! \internal */
 QVariant Converter::toQVariant(GVariant *value)
@@ -36,75 +162,53 @@ QVariant Converter::toQVariant(GVariant *value)
         return result;
     }
 
-    const GVariantType *type = g_variant_get_type(value);
-    if (g_variant_type_equal(type, G_VARIANT_TYPE_BOOLEAN)) {
+    // basic types are identified by the first character of the type string,
+    // which lets the compiler dispatch through a jump table
+    const gchar *typeString = g_variant_get_type_string(value);
+    switch (typeString[0]) {
+    case 'b':
         result.setValue((bool)g_variant_get_boolean(value));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_BYTE)) {
+        break;
+    case 'y':
         result.setValue(g_variant_get_byte(value));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT16)) {
+        break;
+    case 'n':
         result.setValue(qint16(g_variant_get_int16(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT16)) {
+        break;
+    case 'q':
         result.setValue(quint16(g_variant_get_uint16(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT32)) {
+        break;
+    case 'i':
         result.setValue(qint32(g_variant_get_int32(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT32)) {
+        break;
+    case 'u':
         result.setValue(quint32(g_variant_get_uint32(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT64)) {
+        break;
+    case 'x':
         result.setValue(qint64(g_variant_get_int64(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_UINT64)) {
+        break;
+    case 't':
         result.setValue(quint64(g_variant_get_uint64(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_DOUBLE)) {
+        break;
+    case 'd':
         result.setValue(g_variant_get_double(value));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING)) {
+        break;
+    case 's': {
         gsize size = 0;
         const gchar *v = g_variant_get_string(value, &size);
         result.setValue(QString::fromUtf8(v, size));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING_ARRAY)) {
-        gsize size = 0;
-        const gchar **sa = g_variant_get_strv(value, &size);
-        QStringList list;
-        for (gsize i = 0; i < size; ++i) {
-            list << QString::fromUtf8(sa[i]);
-        }
-        result.setValue(list);
-        g_free(sa);
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_BYTESTRING)) {
-        result.setValue(QByteArray(g_variant_get_bytestring(value)));
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_BYTESTRING_ARRAY)) {
-        gsize size = 0;
-        const gchar **bsa = g_variant_get_bytestring_array(value, &size);
-        QByteArrayList list;
-        for (gsize i = 0; i < size; ++i) {
-            list << bsa[i];
-        }
-        result.setValue(list);
-        g_free(bsa);
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_VARIANT)) {
+        break;
+    }
+    case 'v': {
         GVariant *var = g_variant_get_variant(value);
         result = toQVariant(var);
         g_variant_unref(var);
-    } else if (g_variant_type_equal(type, G_VARIANT_TYPE_VARDICT)) {
-        GVariantIter iter;
-        GVariant *vvalue;
-        gchar *key;
-        QVariantMap qmap;
-
-        g_variant_iter_init (&iter, value);
-        while (g_variant_iter_loop (&iter, "{sv}", &key, &vvalue))
-        {
-            qmap.insert(QString::fromUtf8(key), toQVariant(vvalue));
-        }
-
-        result.setValue(qmap);
-    } else if (g_variant_type_is_array(type)) {
-        QVariantList lst;
-        for (int i = 0, iMax = g_variant_n_children(value); i < iMax; i++) {
-            GVariant *child = g_variant_get_child_value(value, i);
-            lst << toQVariant(child);
-            g_variant_unref(child);
-        }
-        result.setValue(lst);
-    } else if (g_variant_type_is_tuple(type)) {
+        break;
+    }
+    case 'a':
+        result = arrayToQVariant(value, typeString);
+        break;
+    case '(': {
         gsize size = g_variant_n_children(value);
         QVariantList vlist;
 
@@ -117,8 +221,11 @@ QVariant Converter::toQVariant(GVariant *value)
         }
 
         result.setValue(vlist);
-    } else {
-        qWarning() << "Unsupported GVariant value" << (char*) type;
+        break;
+    }
+    default:
+        qWarning() << "Unsupported GVariant value" << typeString;
+        break;
     }
 
     /* TODO: implement convertions to others types
@@ -137,27 +244,267 @@ QVariant Converter::toQVariant(GVariant *value)
     return result;
 }
 
-QVariant Converter::toQVariantFromVariantString(const QString &variantString)
+/*! \internal
+    Converts an array of fixed size numbers to a QByteArray (ay) or a
+    QVector of the element type with a single copy of the array data.
+    Returns an invalid QVariant for other types.
+*/
+QVariant Converter::toFixedArray(GVariant *value)
 {
-    GVariant *gvariant;
-    GError *error = NULL;
+    if (value == NULL) {
+        return QVariant();
+    }
 
-    if (variantString.isEmpty()) {
+    const gchar *typeString = g_variant_get_type_string(value);
+    if (typeString[0] != 'a' || typeString[2] != '\0') {
+        return QVariant();
+    }
+
+    switch (typeString[1]) {
+    case 'y': {
+        gsize size = 0;
+        gconstpointer data = g_variant_get_fixed_array(value, &size, sizeof(guchar));
+        return QByteArray(static_cast<const char*>(data), size);
+    }
+    case 'n': return fixedArrayToVector<qint16>(value);
+    case 'q': return fixedArrayToVector<quint16>(value);
+    case 'i': return fixedArrayToVector<qint32>(value);
+    case 'u': return fixedArrayToVector<quint32>(value);
+    case 'x': return fixedArrayToVector<qint64>(value);
+    case 't': return fixedArrayToVector<quint64>(value);
+    case 'd': return fixedArrayToVector<double>(value);
+    default:
         return QVariant();
     }
+}
+
+/*! \internal
+    Indexes the entries of a vardict by key. The values are unboxed and
+    must be unreffed by the caller.
+*/
+static QHash<QString, GVariant*> vardictEntries(GVariant *dict)
+{
+    QHash<QString, GVariant*> entries;
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *child;
+
+    g_variant_iter_init(&iter, dict);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &child)) {
+        GVariant *&entry = entries[QString::fromUtf8(key)];
+        if (entry) {
+            g_variant_unref(entry);
+        }
+        entry = child;
+    }
+    return entries;
+}
+
+/*! \internal */
+static void freeVardictEntries(const QHash<QString, GVariant*> &entries)
+{
+    Q_FOREACH(GVariant *child, entries) {
+        g_variant_unref(child);
+    }
+}
+
+/*! \internal */
+QVariant Converter::toQVariantWithPrevious(GVariant *value, GVariant *previous, const QVariant &previousResult)
+{
+    if (value == NULL || previous == NULL || previousResult.type() != QVariant::Map ||
+            !g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT) ||
+            !g_variant_is_of_type(previous, G_VARIANT_TYPE_VARDICT)) {
+        return toQVariant(value);
+    }
+
+    if (g_variant_equal(value, previous)) {
+        return previousResult;
+    }
+
+    const QVariantMap previousMap = previousResult.toMap();
+    const QHash<QString, GVariant*> previousEntries = vardictEntries(previous);
+    QVariantMap qmap;
+    GVariantIter iter;
+    const gchar *key;
+    GVariant *child;
+
+    g_variant_iter_init(&iter, value);
+    while (g_variant_iter_next(&iter, "{&sv}", &key, &child)) {
+        const QString qkey = QString::fromUtf8(key);
+        GVariant *old = previousEntries.value(qkey);
+        QVariantMap::const_iterator it = previousMap.constFind(qkey);
+
+        // unchanged entries share the previously converted value
+        if (old && it != previousMap.constEnd() && g_variant_equal(old, child)) {
+            qmap.insert(qkey, it.value());
+        } else {
+            qmap.insert(qkey, toQVariant(child));
+        }
+        g_variant_unref(child);
+    }
+
+    freeVardictEntries(previousEntries);
+    return qmap;
+}
+
+/*! \internal */
+QStringList Converter::changedKeys(GVariant *previous, GVariant *value)
+{
+    QStringList keys;
+
+    if (value == NULL || previous == NULL ||
+            !g_variant_is_of_type(value, G_VARIANT_TYPE_VARDICT) ||
+            !g_variant_is_of_type(previous, G_VARIANT_TYPE_VARDICT)) {
+        return keys;
+    }
+
+    QHash<QString, GVariant*> previousEntries = vardictEntries(previous);
+    const QHash<QString, GVariant*> entries = vardictEntries(value);
+
+    QHash<QString, GVariant*>::const_iterator it = entries.constBegin();
+    for (; it != entries.constEnd(); ++it) {
+        GVariant *old = previousEntries.take(it.key());
+        if (!old || !g_variant_equal(old, it.value())) {
+            keys << it.key();
+        }
+        if (old) {
+            g_variant_unref(old);
+        }
+    }
+
+    // whatever is left was removed
+    keys << previousEntries.keys();
+
+    freeVardictEntries(previousEntries);
+    freeVardictEntries(entries);
+    return keys;
+}
+
+// number of parsed variant strings kept, the least recently used go first
+static const int MaxCachedVariantStrings = 128;
+
+/* The result of parsing a variant string, or the reason it failed */
+struct ParsedVariantString
+{
+    QVariant value;
+    QString error;
+};
+
+struct VariantStringCache
+{
+    VariantStringCache()
+        : parsed(MaxCachedVariantStrings),
+          hits(0),
+          misses(0)
+    {
+    }
+
+    QMutex mutex;
+    QCache<QString, ParsedVariantString> parsed;
+    quint64 hits;
+    quint64 misses;
+};
+
+Q_GLOBAL_STATIC(VariantStringCache, variantStringCache)
 
-    gvariant = g_variant_parse (NULL, qUtf8Printable(variantString), NULL, NULL, &error);
+/*! \internal */
+static ParsedVariantString *parseVariantString(const QString &variantString)
+{
+    ParsedVariantString *parsed = new ParsedVariantString;
+    GError *error = NULL;
+
+    GVariant *gvariant = g_variant_parse (NULL, qUtf8Printable(variantString), NULL, NULL, &error);
 
     if (error) {
-        qWarning() << "Impossible to parse" << variantString << "as variant string:"<< error->message;
+        parsed->error = QString::fromUtf8(error->message);
         g_error_free (error);
+    } else {
+        parsed->value = Converter::toQVariant(gvariant);
+        g_variant_unref (gvariant);
+    }
+
+    return parsed;
+}
+
+/*! \internal
+    Parses \a variantString with g_variant_parse. The callers pass the same
+    few literals over and over, so results are kept in a process wide cache,
+    failures included.
+*/
+QVariant Converter::toQVariantFromVariantString(const QString &variantString)
+{
+    if (variantString.isEmpty()) {
         return QVariant();
     }
 
-    const QVariant& qvariant = Converter::toQVariant(gvariant);
-    g_variant_unref (gvariant);
+    VariantStringCache *cache = variantStringCache();
+    QMutexLocker locker(&cache->mutex);
+
+    ParsedVariantString *parsed = cache->parsed.object(variantString);
+    if (parsed) {
+        cache->hits++;
+    } else {
+        cache->misses++;
+        parsed = parseVariantString(variantString);
+        cache->parsed.insert(variantString, parsed);
+
+        // warned about once, later hits fail silently
+        if (!parsed->error.isNull()) {
+            qWarning() << "Impossible to parse" << variantString << "as variant string:"<< parsed->error;
+        }
+    }
+
+    return parsed->value;
+}
 
-    return qvariant;
+/*! \internal */
+quint64 Converter::variantStringCacheHits()
+{
+    VariantStringCache *cache = variantStringCache();
+    QMutexLocker locker(&cache->mutex);
+    return cache->hits;
+}
+
+/*! \internal */
+quint64 Converter::variantStringCacheMisses()
+{
+    VariantStringCache *cache = variantStringCache();
+    QMutexLocker locker(&cache->mutex);
+    return cache->misses;
+}
+
+/*! \internal */
+void Converter::clearVariantStringCache()
+{
+    VariantStringCache *cache = variantStringCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->parsed.clear();
+    cache->hits = 0;
+    cache->misses = 0;
+}
+
+/*! \internal */
+static GVariant* fixedArrayToGVariant(const QVariant &value)
+{
+    const int type = value.userType();
+
+    if (type == qMetaTypeId<QVector<qint16> >()) {
+        return vectorToFixedArray<qint16>(value, G_VARIANT_TYPE_INT16);
+    } else if (type == qMetaTypeId<QVector<quint16> >()) {
+        return vectorToFixedArray<quint16>(value, G_VARIANT_TYPE_UINT16);
+    } else if (type == qMetaTypeId<QVector<qint32> >()) {
+        return vectorToFixedArray<qint32>(value, G_VARIANT_TYPE_INT32);
+    } else if (type == qMetaTypeId<QVector<quint32> >()) {
+        return vectorToFixedArray<quint32>(value, G_VARIANT_TYPE_UINT32);
+    } else if (type == qMetaTypeId<QVector<qint64> >()) {
+        return vectorToFixedArray<qint64>(value, G_VARIANT_TYPE_INT64);
+    } else if (type == qMetaTypeId<QVector<quint64> >()) {
+        return vectorToFixedArray<quint64>(value, G_VARIANT_TYPE_UINT64);
+    } else if (type == qMetaTypeId<QVector<double> >()) {
+        return vectorToFixedArray<double>(value, G_VARIANT_TYPE_DOUBLE);
+    }
+
+    return NULL;
 }
 
 GVariant* Converter::toGVariant(const QVariant &value)
@@ -256,83 +603,193 @@ GVariant* Converter::toGVariant(const QVariant &value)
         break;
     }
     default:
-        qWarning() << "QVariant type not supported:" << value.type();
+        result = fixedArrayToGVariant(value);
+        if (!result) {
+            qWarning() << "QVariant type not supported:" << value.type();
+        }
     }
 
     return result;
 }
 
-GVariant* Converter::toGVariantWithSchema(const QVariant &value, const char* schema)
+/*! \internal
+    A schema walked once into the conversion to apply, with the plans of the
+    elements of arrays and tuples.
+*/
+struct SchemaPlan
 {
-    if (!g_variant_type_string_is_valid(schema)) {
-        return Converter::toGVariant(value);
+    enum Kind {
+        Fallback,
+        Boolean,
+        Byte,
+        Int16,
+        UInt16,
+        Int32,
+        UInt32,
+        Int64,
+        UInt64,
+        Double,
+        String,
+        Variant,
+        VarDict,
+        Array,
+        Tuple
+    };
+
+    SchemaPlan(const GVariantType *type);
+    ~SchemaPlan() { qDeleteAll(elements); }
+
+    Kind kind;
+    QByteArray schema;
+    QVector<SchemaPlan*> elements;
+};
+
+SchemaPlan::SchemaPlan(const GVariantType *type)
+{
+    const gchar *typeString = g_variant_type_peek_string(type);
+    gsize length = g_variant_type_get_string_length(type);
+    schema = QByteArray(typeString, length);
+
+    switch (typeString[0]) {
+    case 'b': kind = Boolean; break;
+    case 'y': kind = Byte; break;
+    case 'n': kind = Int16; break;
+    case 'q': kind = UInt16; break;
+    case 'i': kind = Int32; break;
+    case 'u': kind = UInt32; break;
+    case 'x': kind = Int64; break;
+    case 't': kind = UInt64; break;
+    case 'd': kind = Double; break;
+    case 's': kind = String; break;
+    case 'v': kind = Variant; break;
+    case 'a':
+        if (g_variant_type_equal(type, G_VARIANT_TYPE_VARDICT)) {
+            kind = VarDict;
+        } else {
+            kind = Array;
+            elements << new SchemaPlan(g_variant_type_element(type));
+        }
+        break;
+    case '(':
+        kind = Tuple;
+        for (const GVariantType *entry = g_variant_type_first(type); entry; entry = g_variant_type_next(entry)) {
+            elements << new SchemaPlan(entry);
+        }
+        break;
+    default:
+        kind = Fallback;
+        break;
     }
+}
+
+// upper bound for the number of cached schemas, the cache starts over when reached
+static const int MaxCachedSchemas = 256;
 
+struct SchemaPlanCache
+{
+    QMutex mutex;
+    QHash<QByteArray, QSharedPointer<const SchemaPlan> > plans;
+};
+
+Q_GLOBAL_STATIC(SchemaPlanCache, schemaPlanCache)
+
+/*! \internal */
+static QSharedPointer<const SchemaPlan> planForSchema(const char *schema)
+{
+    SchemaPlanCache *cache = schemaPlanCache();
+    QMutexLocker locker(&cache->mutex);
+
+    QSharedPointer<const SchemaPlan> plan = cache->plans.value(QByteArray::fromRawData(schema, qstrlen(schema)));
+    if (plan.isNull() && g_variant_type_string_is_valid(schema)) {
+        plan = QSharedPointer<const SchemaPlan>(new SchemaPlan(G_VARIANT_TYPE(schema)));
+
+        if (cache->plans.size() >= MaxCachedSchemas)
+            cache->plans.clear();
+        cache->plans.insert(plan->schema, plan);
+    }
+
+    return plan;
+}
+
+/*! \internal */
+static GVariant* toGVariantWithPlan(const QVariant &value, const SchemaPlan *plan)
+{
     GVariant* result = NULL;
-    GVariantType* schema_type = g_variant_type_new(schema);
 
-    if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_BOOLEAN)) {
+    switch (plan->kind) {
+    case SchemaPlan::Boolean:
         if (value.canConvert<bool>()) {
             result = g_variant_new_boolean (value.value<bool>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_BYTE)) {
+        break;
+    case SchemaPlan::Byte:
         if (value.canConvert<uchar>()) {
             result = g_variant_new_byte (value.value<uchar>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_INT16)) {
+        break;
+    case SchemaPlan::Int16:
         if (value.canConvert<qint16>()) {
             result = g_variant_new_int16 (value.value<qint16>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_UINT16)) {
+        break;
+    case SchemaPlan::UInt16:
         if (value.canConvert<quint16>()) {
             result = g_variant_new_uint16 (value.value<quint16>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_INT32)) {
+        break;
+    case SchemaPlan::Int32:
         if (value.canConvert<qint32>()) {
             result = g_variant_new_int32 (value.value<qint32>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_UINT32)) {
+        break;
+    case SchemaPlan::UInt32:
         if (value.canConvert<quint32>()) {
             result = g_variant_new_uint32 (value.value<quint32>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_INT64)) {
+        break;
+    case SchemaPlan::Int64:
         if (value.canConvert<qint64>()) {
             result = g_variant_new_int64 (value.value<qint64>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_UINT64)) {
+        break;
+    case SchemaPlan::UInt64:
         if (value.canConvert<quint64>()) {
             result = g_variant_new_uint64 (value.value<quint64>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_DOUBLE)) {
+        break;
+    case SchemaPlan::Double:
         if (value.canConvert<double>()) {
             result = g_variant_new_double (value.value<double>());
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_STRING)) {
+        break;
+    case SchemaPlan::String:
         if (value.canConvert<QString>()) {
             result = g_variant_new_string(qUtf8Printable(value.toString()));
         }
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_VARIANT)) {
+        break;
+    case SchemaPlan::Variant:
         result = g_variant_new_variant(Converter::toGVariant(value));
-    } else if (g_variant_type_equal(schema_type, G_VARIANT_TYPE_VARDICT)) {
+        break;
+    case SchemaPlan::VarDict:
         if (value.canConvert(QVariant::Map)) {
             result = Converter::toGVariant(value.toMap());
         }
-    } else if (g_variant_type_is_array(schema_type)) {
+        break;
+    case SchemaPlan::Array:
         if (value.canConvert(QVariant::List)) {
-            const GVariantType* entryType = g_variant_type_element(schema_type);
-            const gchar* entryTypeString = g_variant_type_peek_string(entryType);
+            const SchemaPlan *entryPlan = plan->elements.first();
 
             GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE_ARRAY);
             bool ok = true;
 
-            for (const QVariant &v : value.toList()) {
-                GVariant *data = toGVariantWithSchema(v, entryTypeString);
+            for (const QVariant &v : value.value<QVariantList>()) {
+                GVariant *data = toGVariantWithPlan(v, entryPlan);
 
                 if (data) {
                     g_variant_builder_add_value(b, data);
                 } else {
                     ok = false;
-                    qWarning() << "Failed to convert list to array with schema:" << schema;
+                    qWarning() << "Failed to convert list to array with schema:" << plan->schema.constData();
                     break;
                 }
             }
@@ -341,26 +798,24 @@ GVariant* Converter::toGVariantWithSchema(const QVariant &value, const char* sch
             }
             g_variant_builder_unref(b);
         }
-    } else if (g_variant_type_is_tuple(schema_type)) {
+        break;
+    case SchemaPlan::Tuple:
         if (value.canConvert(QVariant::List)) {
-            const GVariantType* entryType = g_variant_type_first(schema_type);
-
             GVariantBuilder *b = g_variant_builder_new(G_VARIANT_TYPE_TUPLE);
             bool ok = true;
+            int entry = 0;
 
-            for (const QVariant &v : value.toList()) {
-                gchar* entryTypeString = g_variant_type_dup_string(entryType);
-                GVariant *data = toGVariantWithSchema(v, entryTypeString);
-                g_free(entryTypeString);
+            for (const QVariant &v : value.value<QVariantList>()) {
+                if (entry >= plan->elements.size())
+                    break;
+
+                GVariant *data = toGVariantWithPlan(v, plan->elements.at(entry++));
 
                 if (data) {
                     g_variant_builder_add_value(b, data);
-                    entryType = g_variant_type_next(entryType);
-                    if (!entryType)
-                        break;
                 } else {
                     ok = false;
-                    qWarning() << "Failed to convert list to array with schema:" << schema;
+                    qWarning() << "Failed to convert list to array with schema:" << plan->schema.constData();
                     break;
                 }
             }
@@ -369,6 +824,9 @@ GVariant* Converter::toGVariantWithSchema(const QVariant &value, const char* sch
             }
             g_variant_builder_unref(b);
         }
+        break;
+    case SchemaPlan::Fallback:
+        break;
     }
 
     // fallback to straight convert.
@@ -376,8 +834,20 @@ GVariant* Converter::toGVariantWithSchema(const QVariant &value, const char* sch
         result = Converter::toGVariant(value);
     }
 
-    g_free(schema_type);
-
     return result;
 }
 
+GVariant* Converter::toGVariantWithSchema(const QVariant &value, const char* schema)
+{
+    QSharedPointer<const SchemaPlan> plan;
+
+    if (schema) {
+        plan = planForSchema(schema);
+    }
+
+    if (plan.isNull()) {
+        return Converter::toGVariant(value);
+    }
+
+    return toGVariantWithPlan(value, plan.data());
+}
@@ -20,8 +20,11 @@
 #ifndef CONVERTER_H
 #define CONVERTER_H
 
+#include <QtGlobal>
+
 typedef struct _GVariant GVariant;
 class QString;
+class QStringList;
 class QVariant;
 
 class Converter
@@ -29,11 +32,25 @@ class Converter
 public:
     static QVariant toQVariant(GVariant *value);
     static QVariant toQVariantFromVariantString(const QString &variantString);
+    static QVariant toFixedArray(GVariant *value);
+
+    // Converts a vardict state, reusing the entries of previousResult (the
+    // conversion of previous) whose value did not change. Any other value is
+    // converted as by toQVariant.
+    static QVariant toQVariantWithPrevious(GVariant *value, GVariant *previous, const QVariant &previousResult);
+    // The keys that were added, removed or changed between two vardicts.
+    // Empty when the values are not both vardicts.
+    static QStringList changedKeys(GVariant *previous, GVariant *value);
     static GVariant* toGVariant(const QVariant &value);
 
     // This converts a QVariant to a GVariant using a provided gvariant schema as
     // a conversion base (it will attempt to convert to this format).
     static GVariant* toGVariantWithSchema(const QVariant &value, const char* schema);
+
+    // Statistics of the cache of toQVariantFromVariantString
+    static quint64 variantStringCacheHits();
+    static quint64 variantStringCacheMisses();
+    static void clearVariantStringCache();
 };
 
 #endif // CONVERTER_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C" {
+#include <gio/gio.h>
+}
+
+#include "iconcache.h"
+#include "bytesiconprovider.h"
+
+#include <QHash>
+#include <QIcon>
+
+// upper bound for the number of cached uris, the cache starts over when reached
+static const int MaxCachedIcons = 1024;
+
+struct IconCacheData
+{
+    IconCacheData() : generation(0), hits(0), misses(0) {}
+
+    void checkTheme();
+
+    QHash<QByteArray, QString> uris;
+    QString themeName;
+    quint32 generation;
+    quint64 hits;
+    quint64 misses;
+};
+
+Q_GLOBAL_STATIC(IconCacheData, iconCache)
+
+void IconCacheData::checkTheme()
+{
+    const QString currentTheme = QIcon::themeName();
+    if (themeName != currentTheme) {
+        uris.clear();
+        themeName = currentTheme;
+        generation++;
+    }
+}
+
+static QString resolveIconUri(GIcon *icon)
+{
+    QString uri;
+
+    if (G_IS_THEMED_ICON (icon)) {
+        const gchar* const* iconNames = g_themed_icon_get_names (G_THEMED_ICON (icon));
+        guint index = 0;
+        while(iconNames[index] != NULL) {
+            if (QIcon::hasThemeIcon(iconNames[index])) {
+                uri = QString("image://theme/") + iconNames[index];
+                break;
+            }
+            index++;
+        }
+    }
+    else if (G_IS_FILE_ICON (icon)) {
+        GFile *file;
+
+        file = g_file_icon_get_file (G_FILE_ICON (icon));
+        if (file) {
+            gchar *fileuri;
+
+            fileuri = g_file_get_uri (file);
+            uri = QString(fileuri);
+
+            g_free (fileuri);
+        }
+    }
+    else if (G_IS_BYTES_ICON (icon)) {
+        uri = BytesIconProvider::uriForBytes (g_bytes_icon_get_bytes (G_BYTES_ICON (icon)));
+    }
+
+    return uri;
+}
+
+QString IconCache::iconUri(GIcon *icon)
+{
+    IconCacheData *cache = iconCache();
+    gchar *serialized;
+    QString uri;
+
+    // icons without a string representation (GBytesIcon) are not cached
+    serialized = g_icon_to_string (icon);
+    if (serialized == NULL)
+        return resolveIconUri(icon);
+
+    cache->checkTheme();
+
+    QByteArray key = QByteArray::fromRawData(serialized, qstrlen(serialized));
+    QHash<QByteArray, QString>::const_iterator it = cache->uris.constFind(key);
+    if (it != cache->uris.constEnd()) {
+        cache->hits++;
+        uri = it.value();
+    } else {
+        cache->misses++;
+        uri = resolveIconUri(icon);
+
+        if (cache->uris.size() >= MaxCachedIcons)
+            cache->uris.clear();
+        cache->uris.insert(QByteArray(serialized), uri);
+    }
+
+    g_free (serialized);
+    return uri;
+}
+
+QString IconCache::acquireIconUri(GIcon *icon)
+{
+    if (G_IS_BYTES_ICON (icon))
+        return BytesIconProvider::acquireUri (g_bytes_icon_get_bytes (G_BYTES_ICON (icon)));
+
+    return iconUri(icon);
+}
+
+void IconCache::releaseIconUri(const QString &uri)
+{
+    BytesIconProvider::releaseUri(uri);
+}
+
+quint32 IconCache::generation()
+{
+    IconCacheData *cache = iconCache();
+
+    cache->checkTheme();
+    return cache->generation;
+}
+
+quint64 IconCache::hits()
+{
+    return iconCache()->hits;
+}
+
+quint64 IconCache::misses()
+{
+    return iconCache()->misses;
+}
+
+void IconCache::clear()
+{
+    IconCacheData *cache = iconCache();
+
+    cache->uris.clear();
+    cache->generation++;
+    cache->hits = 0;
+    cache->misses = 0;
+}
@@ -0,0 +1,47 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONCACHE_H
+#define ICONCACHE_H
+
+#include <QString>
+
+typedef struct _GIcon GIcon;
+
+/* Process wide cache of the uris GIcons resolve to. Resolving themed icons
+ * asks the icon theme about every candidate name, so the result is kept
+ * until the icon theme changes. Must be used from the gui thread. */
+class IconCache
+{
+public:
+    static QString iconUri(GIcon *icon);
+
+    /* Like iconUri(), but the uri of an icon sent as image data keeps
+     * resolving until it is passed to releaseIconUri(). Uris kept for as long
+     * as a row shows them are resolved this way. */
+    static QString acquireIconUri(GIcon *icon);
+    static void releaseIconUri(const QString &uri);
+
+    /* Changes whenever the cached uris are dropped, e.g. because the icon
+     * theme changed. Uris kept elsewhere are stale once it differs. */
+    static quint32 generation();
+
+    static quint64 hits();
+    static quint64 misses();
+    static void clear();
+};
+
+#endif // ICONCACHE_H
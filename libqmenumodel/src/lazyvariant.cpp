@@ -0,0 +1,251 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+extern "C" {
+#include <glib.h>
+}
+
+#include "lazyvariant.h"
+#include "converter.h"
+
+class LazyVariantData : public QSharedData
+{
+public:
+    LazyVariantData(GVariant *value)
+        : value(g_variant_ref_sink(value)),
+          converted(false)
+    {
+    }
+
+    ~LazyVariantData()
+    {
+        g_variant_unref(value);
+    }
+
+    GVariant *value;
+    QVariant variant;
+    bool converted;
+
+    // closest earlier state that was converted, dropped once this one is
+    QExplicitlySharedDataPointer<LazyVariantData> previous;
+};
+
+static void registerLazyVariant()
+{
+    qRegisterMetaType<LazyVariant>("LazyVariant");
+    QMetaType::registerConverter<LazyVariant, QVariantMap>(&LazyVariant::toMap);
+    QMetaType::registerConverter<LazyVariant, QVariantList>(&LazyVariant::toList);
+    QMetaType::registerEqualsComparator<LazyVariant>();
+}
+Q_CONSTRUCTOR_FUNCTION(registerLazyVariant)
+
+/* dictionaries with string keys can be looked up without iterating */
+static bool isDictionary(GVariant *value)
+{
+    return g_variant_is_of_type(value, G_VARIANT_TYPE ("a{s*}"));
+}
+
+/* converts a child value, looking through the variant boxing of a{sv} and av */
+static QVariant childToQVariant(GVariant *child)
+{
+    QVariant result;
+
+    if (child) {
+        if (g_variant_is_of_type(child, G_VARIANT_TYPE_VARIANT)) {
+            GVariant *boxed = g_variant_get_variant(child);
+            result = Converter::toQVariant(boxed);
+            g_variant_unref(boxed);
+        } else {
+            result = Converter::toQVariant(child);
+        }
+        g_variant_unref(child);
+    }
+
+    return result;
+}
+
+LazyVariant::LazyVariant()
+{
+}
+
+LazyVariant::LazyVariant(GVariant *value)
+{
+    if (value) {
+        d = new LazyVariantData(value);
+    }
+}
+
+LazyVariant::LazyVariant(const LazyVariant &other)
+    : d(other.d)
+{
+}
+
+LazyVariant::~LazyVariant()
+{
+}
+
+LazyVariant &LazyVariant::operator=(const LazyVariant &other)
+{
+    d = other.d;
+    return *this;
+}
+
+bool LazyVariant::operator==(const LazyVariant &other) const
+{
+    if (d == other.d) {
+        return true;
+    } else if (!d || !other.d) {
+        return false;
+    }
+    return g_variant_equal(d->value, other.d->value);
+}
+
+bool LazyVariant::operator!=(const LazyVariant &other) const
+{
+    return !(*this == other);
+}
+
+bool LazyVariant::isNull() const
+{
+    return !d;
+}
+
+/* Whether toVariant() was called on this value or a copy of it */
+bool LazyVariant::isConverted() const
+{
+    return d && d->converted;
+}
+
+GVariant *LazyVariant::gvariant() const
+{
+    return d ? d->value : NULL;
+}
+
+void LazyVariant::setPrevious(const LazyVariant &previous)
+{
+    if (!d || !previous.d || d == previous.d || d->converted) {
+        return;
+    }
+
+    // only keep a state that has a conversion to reuse, so that states which
+    // were never read do not pile up
+    if (previous.d->converted) {
+        d->previous = previous.d;
+    } else {
+        d->previous = previous.d->previous;
+    }
+}
+
+QStringList LazyVariant::changedKeys(const LazyVariant &previous) const
+{
+    return Converter::changedKeys(previous.gvariant(), gvariant());
+}
+
+int LazyVariant::count() const
+{
+    if (!d || !g_variant_is_container(d->value)) {
+        return 0;
+    }
+    return g_variant_n_children(d->value);
+}
+
+QStringList LazyVariant::keys() const
+{
+    QStringList result;
+
+    if (d && isDictionary(d->value)) {
+        GVariantIter iter;
+        const gchar *key;
+
+        g_variant_iter_init(&iter, d->value);
+        while (g_variant_iter_next(&iter, "{&s*}", &key, NULL)) {
+            result << QString::fromUtf8(key);
+        }
+    }
+
+    return result;
+}
+
+bool LazyVariant::contains(const QString &key) const
+{
+    if (!d || !isDictionary(d->value)) {
+        return false;
+    }
+
+    GVariant *child = g_variant_lookup_value(d->value, key.toUtf8().constData(), NULL);
+    if (child) {
+        g_variant_unref(child);
+        return true;
+    }
+    return false;
+}
+
+/* Returns the entry of a dictionary with string keys, converting only that entry. */
+QVariant LazyVariant::value(const QString &key) const
+{
+    if (!d || !isDictionary(d->value)) {
+        return QVariant();
+    } else if (d->converted) {
+        return d->variant.toMap().value(key);
+    }
+
+    // g_variant_lookup_value already unboxes the values of a{sv}
+    GVariant *child = g_variant_lookup_value(d->value, key.toUtf8().constData(), NULL);
+    if (child) {
+        QVariant result = Converter::toQVariant(child);
+        g_variant_unref(child);
+        return result;
+    }
+    return QVariant();
+}
+
+/* Returns the child at index of an array or tuple, converting only that child. */
+QVariant LazyVariant::at(int index) const
+{
+    if (index < 0 || index >= count()) {
+        return QVariant();
+    }
+    return childToQVariant(g_variant_get_child_value(d->value, index));
+}
+
+QVariant LazyVariant::toVariant() const
+{
+    if (!d) {
+        return QVariant();
+    }
+
+    if (!d->converted) {
+        if (d->previous) {
+            d->variant = Converter::toQVariantWithPrevious(d->value, d->previous->value, d->previous->variant);
+            d->previous.reset();
+        } else {
+            d->variant = Converter::toQVariant(d->value);
+        }
+        d->converted = true;
+    }
+    return d->variant;
+}
+
+QVariantMap LazyVariant::toMap() const
+{
+    return toVariant().toMap();
+}
+
+QVariantList LazyVariant::toList() const
+{
+    // arrays of int and double convert to a QVector
+    return toVariant().value<QVariantList>();
+}
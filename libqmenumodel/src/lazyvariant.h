@@ -0,0 +1,74 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LAZYVARIANT_H
+#define LAZYVARIANT_H
+
+#include <QExplicitlySharedDataPointer>
+#include <QMetaType>
+#include <QStringList>
+#include <QVariant>
+
+typedef struct _GVariant GVariant;
+class LazyVariantData;
+
+/* Keeps a reference to a GVariant and converts it to a QVariant only when
+ * it is read. Dictionaries and arrays can be read one entry at a time
+ * without converting the rest of the value. Copies share the converted
+ * value, so it is converted at most once. Must be used from a single thread. */
+class LazyVariant
+{
+    Q_GADGET
+    Q_PROPERTY(int count READ count)
+    Q_PROPERTY(QStringList keys READ keys)
+
+public:
+    LazyVariant();
+    explicit LazyVariant(GVariant *value);
+    LazyVariant(const LazyVariant &other);
+    ~LazyVariant();
+
+    LazyVariant &operator=(const LazyVariant &other);
+    bool operator==(const LazyVariant &other) const;
+    bool operator!=(const LazyVariant &other) const;
+
+    bool isNull() const;
+    bool isConverted() const;
+    GVariant *gvariant() const;
+
+    /* The state this one replaces. When both are vardicts the entries that
+     * did not change reuse the conversion of the previous state. */
+    void setPrevious(const LazyVariant &previous);
+    QStringList changedKeys(const LazyVariant &previous) const;
+
+    int count() const;
+    QStringList keys() const;
+
+    Q_INVOKABLE bool contains(const QString &key) const;
+    Q_INVOKABLE QVariant value(const QString &key) const;
+    Q_INVOKABLE QVariant at(int index) const;
+    Q_INVOKABLE QVariant toVariant() const;
+
+    QVariantMap toMap() const;
+    QVariantList toList() const;
+
+private:
+    QExplicitlySharedDataPointer<LazyVariantData> d;
+};
+
+Q_DECLARE_METATYPE(LazyVariant)
+
+#endif // LAZYVARIANT_H
@@ -24,9 +24,15 @@
 #include <QDebug>
 #include <QCoreApplication>
 
-MenuNode::MenuNode(const QString &linkType, GMenuModel *model, MenuNode *parent, int pos, QObject *listener)
+MenuNode::MenuNode(const QString &linkType, GMenuModel *model, MenuNode *parent, int pos, QObject *listener, bool lazy)
     : m_model(model),
       m_parent(parent),
+      m_position(pos),
+      m_depth(parent ? parent->m_depth + 1 : 0),
+      m_nodes(parent ? parent->m_nodes : new QMultiHash<GMenuModel*, MenuNode*>()),
+      m_populated(false),
+      m_lazy(parent ? parent->m_lazy : lazy),
+      m_listener(listener),
       m_signalChangedId(0),
       m_linkType(linkType),
       m_currentOpPosition(-1),
@@ -34,29 +40,29 @@ MenuNode::MenuNode(const QString &linkType, GMenuModel *model, MenuNode *parent,
       m_currentOpRemoved(0)
 {
     g_object_ref(model);
+    m_nodes->insert(model, this);
 
     if (m_parent) {
         m_parent->insertChild(this, pos);
     }
-
-    m_size = g_menu_model_get_n_items(model);
-    for(int i=0; i < m_size; i++) {
-        MenuNode::create(model, i, this, listener);
+    if (!m_parent || !m_lazy) {
+        populate();
     }
-
-    connect(listener);
 }
 
 MenuNode::~MenuNode()
 {
     disconnect();
-    Q_FOREACH(MenuNode *child, m_children) {
-        delete child;
-    }
+    qDeleteAll(m_children);
     m_children.clear();
+    m_attributes.clear();
     if (m_model) {
+        m_nodes->remove(m_model, this);
         g_object_unref(m_model);
     }
+    if (!m_parent) {
+        delete m_nodes;
+    }
 }
 
 void MenuNode::connect(QObject *listener)
@@ -77,13 +83,34 @@ void MenuNode::disconnect()
     }
 }
 
-int MenuNode::position() const
+bool MenuNode::isPopulated() const
 {
-    if (m_parent) {
-        return m_parent->childPosition(this);
-    } else {
-        return 0;
+    return m_populated;
+}
+
+/* Creates the nodes of the links of this menu and starts to follow its
+ * changes. In a lazy tree only the root is populated on construction, since
+ * reading the items of a remote menu subscribes to it. */
+void MenuNode::populate()
+{
+    if (m_populated) {
+        return;
     }
+    m_populated = true;
+
+    int size = g_menu_model_get_n_items(m_model);
+    m_children.fill(0, size);
+    m_attributes.resize(size);
+    for(int i=0; i < size; i++) {
+        MenuNode::create(m_model, i, this, m_listener);
+    }
+
+    connect(m_listener);
+}
+
+int MenuNode::position() const
+{
+    return m_position;
 }
 
 MenuNode *MenuNode::parent() const
@@ -103,48 +130,43 @@ QString MenuNode::linkType() const
 
 MenuNode *MenuNode::child(int pos) const
 {
-    if (m_children.contains(pos)) {
-        return m_children.value(pos);
-    }
-    return 0;
+    return m_children.value(pos, 0);
 }
 
 int MenuNode::childPosition(GMenuModel *item) const
 {
-    QMap<int, MenuNode*>::const_iterator i = m_children.constBegin();
-    while (i != m_children.constEnd()) {
-        if (i.value()->m_model == item) {
-            return i.key();
+    // a model linked from several places has a node for each of them
+    QMultiHash<GMenuModel*, MenuNode*>::const_iterator it = m_nodes->constFind(item);
+    for (; (it != m_nodes->constEnd()) && (it.key() == item); ++it) {
+        if (it.value()->m_parent == this) {
+            return it.value()->m_position;
         }
-        ++i;
     }
     return 0;
 }
+
 int MenuNode::childPosition(const MenuNode *item) const
 {
-    return childPosition(item->m_model);
+    if (item->m_parent == this) {
+        return item->m_position;
+    }
+    return 0;
 }
 
 int MenuNode::size() const
 {
-    return m_size;
+    return m_children.size();
 }
 
 int MenuNode::depth() const
 {
-    int depth = 0;
-    const MenuNode *child = this;
-    while(child->parent()) {
-        depth++;
-        child = child->parent();
-    }
-    return depth;
+    return m_depth;
 }
 
 int MenuNode::realPosition(int row) const
 {
     int result = row;
-    if ((row >= 0) && (row < m_size)) {
+    if ((row >= 0) && (row < m_children.size())) {
         if (row >= m_currentOpPosition) {
             if ((m_currentOpRemoved > 0) && (row < (m_currentOpPosition + m_currentOpRemoved))) {
                 result = -1;
@@ -158,62 +180,82 @@ int MenuNode::realPosition(int row) const
     }
 }
 
+bool MenuNode::cachedAttribute(int pos, int key, QVariant *value) const
+{
+    if ((pos < 0) || (pos >= m_attributes.size())) {
+        return false;
+    }
+
+    const QHash<int, QVariant> &attributes = m_attributes.at(pos);
+    QHash<int, QVariant>::const_iterator it = attributes.constFind(key);
+    if (it == attributes.constEnd()) {
+        return false;
+    }
+
+    *value = it.value();
+    return true;
+}
+
+void MenuNode::cacheAttribute(int pos, int key, const QVariant &value)
+{
+    if ((pos >= 0) && (pos < m_attributes.size())) {
+        m_attributes[pos].insert(key, value);
+    }
+}
+
 void MenuNode::change(int start, int added, int removed)
 {
-    if (added > 0) {
-        for (int i=(m_size - 1 + added), iMin=start; i >= iMin; i--) {
-            if (m_children.contains(i)) {
-                m_children.insert(i + added, m_children.take(i));
-            }
-        }
+    if ((start < 0) || (start + removed > m_children.size())) {
+        return;
+    }
 
-        m_size += added;
+    // items-changed replaces the removed items by the added ones, so the
+    // removed range has to go before the new items are created in its place
+    if (removed > 0) {
+        for (int i = start; i < (start + removed); i++) {
+            delete m_children.at(i);
+        }
+        m_children.remove(start, removed);
+        m_attributes.remove(start, removed);
+    }
 
+    if (added > 0) {
+        m_children.insert(start, added, 0);
+        m_attributes.insert(start, added, QHash<int, QVariant>());
         for (int i = start; i < (start + added); i++) {
             MenuNode::create(m_model, i, this, m_listener);
         }
     }
 
-    if (removed > 0) {
-        int removedEnd = start + removed;
-        for (int i=start, iMax=m_size; i < iMax; i++) {
-            if (i <= removedEnd) {
-                delete m_children.take(i);
-            } else if (m_children.contains(i)) {
-                m_children.insert(i - removed, m_children.take(i));
+    if (added != removed) {
+        for (int i = start + added, iMax = m_children.size(); i < iMax; i++) {
+            MenuNode *child = m_children.at(i);
+            if (child) {
+                child->m_position = i;
             }
         }
-        m_size -= removed;
     }
 }
 
 void MenuNode::insertChild(MenuNode *child, int pos)
 {
-    if (m_children.contains(pos)) {
+    if ((pos < 0) || (pos >= m_children.size())) {
+        qWarning() << "Invalid position: parent" << this << "child" << child << "pos" << pos;
+        return;
+    }
+
+    if (m_children.at(pos)) {
         qWarning() << "Section conflic: parent" << this << "child" << child << "pos" << pos;
         return;
     }
 
     child->m_parent = this;
-    m_children.insert(pos, child);
+    child->m_position = pos;
+    child->m_depth = m_depth + 1;
+    m_children[pos] = child;
 }
 
 
-MenuNode *MenuNode::find(GMenuModel *item)
-{
-    if (m_model == item) {
-        return this;
-    }
-
-    Q_FOREACH(MenuNode *child, m_children) {
-        MenuNode *found = child->find(item);
-        if (found) {
-            return found;
-        }
-    }
-    return 0;
-}
-
 MenuNode *MenuNode::create(GMenuModel *model, int pos, MenuNode *parent, QObject *listener)
 {
     QString linkType(G_MENU_LINK_SUBMENU);
@@ -231,6 +273,14 @@ MenuNode *MenuNode::create(GMenuModel *model, int pos, MenuNode *parent, QObject
 
 void MenuNode::commitOperation()
 {
+    if ((m_currentOpRemoved > 0) && (m_currentOpAdded > 0)) {
+        // commit the removal first, so that listeners can announce both
+        // halves of the operation separately
+        change(m_currentOpPosition, 0, m_currentOpRemoved);
+        m_currentOpRemoved = 0;
+        return;
+    }
+
     change(m_currentOpPosition, m_currentOpAdded, m_currentOpRemoved);
 
     m_currentOpPosition = -1;
@@ -244,8 +294,10 @@ void MenuNode::onItemsChanged(GMenuModel *model, gint position, gint removed, gi
     self->m_currentOpAdded = added;
     self->m_currentOpRemoved = removed;
 
-    MenuNodeItemChangeEvent mnice(self, position, added, removed);
+    MenuNodeItemChangeEvent mnice(self, position, removed, added);
     QCoreApplication::sendEvent(self->m_listener, &mnice);
 
-    self->commitOperation();
+    while (self->m_currentOpPosition >= 0) {
+        self->commitOperation();
+    }
 }
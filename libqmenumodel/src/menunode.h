@@ -22,7 +22,8 @@
 
 #include <QObject>
 #include <QPointer>
-#include <QMap>
+#include <QMultiHash>
+#include <QVector>
 #include <QVariant>
 
 extern "C" {
@@ -32,7 +33,7 @@ extern "C" {
 class MenuNode
 {
 public:
-    MenuNode(const QString &linkType, GMenuModel *model, MenuNode *parent, int pos, QObject *listener);
+    MenuNode(const QString &linkType, GMenuModel *model, MenuNode *parent, int pos, QObject *listener, bool lazy = false);
     ~MenuNode();
 
     int position() const;
@@ -42,6 +43,8 @@ public:
 
     void connect(QObject *listener);
     void disconnect();
+    bool isPopulated() const;
+    void populate();
     int size() const;
     MenuNode *child(int pos) const;
 
@@ -51,18 +54,28 @@ public:
 
     int depth() const;
     void change(int start, int added, int removed);
-    MenuNode *find(GMenuModel *item);
 
     int realPosition(int row) const;
+    bool cachedAttribute(int pos, int key, QVariant *value) const;
+    void cacheAttribute(int pos, int key, const QVariant &value);
     void commitOperation();
 
     static MenuNode *create(GMenuModel *model, int pos, MenuNode *parent=0, QObject *listener=0);
 
 private:
     GMenuModel *m_model;
-    QMap<int, MenuNode*> m_children;
+    // one slot per item, NULL for items without a section or submenu link
+    QVector<MenuNode*> m_children;
+    // decoded attributes of each item, dropped when items-changed covers it
+    QVector<QHash<int, QVariant> > m_attributes;
     MenuNode* m_parent;
-    int m_size;
+    int m_position;
+    int m_depth;
+    // shared by the whole tree and owned by the root node
+    QMultiHash<GMenuModel*, MenuNode*> *m_nodes;
+    bool m_populated;
+    // nodes below the root are only populated on demand, inherited by children
+    bool m_lazy;
     QObject *m_listener;
     gulong m_signalChangedId;
     QString m_linkType;
@@ -19,12 +19,14 @@
 
 #include "actionstateparser.h"
 #include "qdbusactiongroup.h"
+#include "qdbusactionlistmodel.h"
 #include "qstateaction.h"
 #include "converter.h"
 #include "qmenumodelevents.h"
 
 // Qt
 #include <QCoreApplication>
+#include <QMetaMethod>
 
 extern "C" {
 #include <glib.h>
@@ -60,7 +62,9 @@ QDBusActionGroup::QDBusActionGroup(QObject *parent)
     :QObject(parent),
      QDBusObject(this),
      m_actionGroup(NULL),
-     m_actionStateParser(new ActionStateParser(this))
+     m_populating(false),
+     m_actionStateParser(ActionStateParser::sharedParser()),
+     m_actionsModel(new QDBusActionListModel(this))
 {
 }
 
@@ -68,18 +72,27 @@ QDBusActionGroup::QDBusActionGroup(QObject *parent)
 QDBusActionGroup::~QDBusActionGroup()
 {
     clear();
+
+    // the actions unregister themselves, which needs to happen while the
+    // index still exists
+    QList<QStateAction*> actions = m_actions.values();
+    m_actions.clear();
+    qDeleteAll(actions);
 }
 
 QStringList QDBusActionGroup::actions() const
 {
-    if (!m_actionGroup) return QStringList();
-    QStringList list;
-    gchar** actions = g_action_group_list_actions(m_actionGroup);
-    for (uint i = 0; actions[i]; i++) {
-        list << QString(actions[i]);
-    }
-    g_strfreev(actions);
-    return list;
+    return m_actionsModel->actions();
+}
+
+/*!
+    \qmlproperty QDBusActionListModel QDBusActionGroup::actionsModel
+    This property holds a list model of the names of the actions, which is
+    updated incrementally as actions appear and vanish.
+*/
+QDBusActionListModel *QDBusActionGroup::actionsModel() const
+{
+    return m_actionsModel;
 }
 
 /*!
@@ -94,6 +107,7 @@ QStateAction *QDBusActionGroup::action(const QString &name)
     QStateAction *act = actionImpl(name);
     if (act == 0) {
         act = new QStateAction(this, name);
+        m_actions.insert(name, act);
     }
 
     return act;
@@ -102,10 +116,11 @@ QStateAction *QDBusActionGroup::action(const QString &name)
 QVariant QDBusActionGroup::actionState(const QString &name)
 {
     QVariant result;
-    GVariant *state = g_action_group_get_action_state(m_actionGroup, name.toUtf8().data());
+    const QByteArray actionName = name.toUtf8();
+    GVariant *state = g_action_group_get_action_state(m_actionGroup, actionName.constData());
 
     if (m_actionStateParser != NULL) {
-        result = m_actionStateParser->toQVariant(state);
+        result = m_actionStateParser->parseState(actionName.constData(), state);
     } else {
         result = Converter::toQVariant(state);
     }
@@ -128,12 +143,18 @@ bool QDBusActionGroup::hasAction(const QString &name)
 
 QStateAction *QDBusActionGroup::actionImpl(const QString &name)
 {
-    Q_FOREACH(QStateAction *act, this->findChildren<QStateAction*>()) {
-        if (act->name() == name) {
-            return act;
-        }
-    }
-    return 0;
+    return m_actions.value(name);
+}
+
+/*! \internal
+    Returns whether anyone is interested in state changes of the action
+    \a name. States of other actions are neither converted nor dispatched;
+    new observers read the current state when they attach.
+*/
+bool QDBusActionGroup::isStateObserved(const QString &name) const
+{
+    static const QMetaMethod actionStateChangedSignal = QMetaMethod::fromSignal(&QDBusActionGroup::actionStateChanged);
+    return m_actions.contains(name) || isSignalConnected(actionStateChangedSignal);
 }
 
 /*! \internal */
@@ -201,12 +222,20 @@ void QDBusActionGroup::setActionGroup(GDBusActionGroup *ag)
                                                    G_CALLBACK(QDBusActionGroup::onActionStateChanged),
                                                    this);
 
+        // the initial actions are delivered in one pass. A remote group
+        // usually lists none yet and reports them all at once when its
+        // description arrives, which onActionAdded collects
         gchar **actions = g_action_group_list_actions(m_actionGroup);
-        for(guint i=0; i < g_strv_length(actions); i++) {
-            DBusActionVisiblityEvent dave(actions[i], true);
-            QCoreApplication::sendEvent(this, &dave);
+        for (guint i = 0; actions[i]; i++) {
+            m_appearedActions << QString::fromUtf8(actions[i]);
         }
         g_strfreev(actions);
+
+        if (m_appearedActions.isEmpty()) {
+            m_populating = true;
+        } else {
+            flushAppearedActions();
+        }
     }
 }
 
@@ -233,7 +262,12 @@ void QDBusActionGroup::clear()
         m_signalActionAddId = m_signalActionRemovedId = m_signalStateChangedId = 0;
     }
 
-    Q_FOREACH(QStateAction *act, this->findChildren<QStateAction*>()) {
+    m_populating = false;
+    m_appearedActions.clear();
+    m_vanishedActions.clear();
+
+    Q_FOREACH(QStateAction *act, m_actions) {
+        act->onActionVanish();
         Q_EMIT actionVanish(act->name());
     }
 
@@ -241,6 +275,61 @@ void QDBusActionGroup::clear()
         g_object_unref(m_actionGroup);
         m_actionGroup = NULL;
     }
+
+    m_actionsModel->clear();
+}
+
+/*! \internal
+    Delivers the actions that appeared since the last call: one row insertion
+    in the actions model, the appearance of each action and a single
+    actionsChanged. Actions added after that are delivered one by one.
+*/
+void QDBusActionGroup::flushAppearedActions()
+{
+    if (m_appearedActions.isEmpty()) {
+        return;
+    }
+
+    const QStringList names = m_appearedActions;
+    m_appearedActions.clear();
+    m_populating = false;
+
+    m_actionsModel->appendActions(names);
+
+    Q_FOREACH(const QString &name, names) {
+        QStateAction *act = actionImpl(name);
+        if (act) {
+            act->onActionAppear();
+        }
+        Q_EMIT actionAppear(name);
+    }
+    Q_EMIT actionsChanged();
+}
+
+/*! \internal
+    Delivers the actions that were removed since the last call: the row
+    removals in the actions model, done range by range, the disappearance of
+    each action and a single actionsChanged.
+*/
+void QDBusActionGroup::flushVanishedActions()
+{
+    if (m_vanishedActions.isEmpty()) {
+        return;
+    }
+
+    const QStringList names = m_vanishedActions;
+    m_vanishedActions.clear();
+
+    m_actionsModel->removeActions(names);
+
+    Q_FOREACH(const QString &name, names) {
+        QStateAction *act = actionImpl(name);
+        if (act) {
+            act->onActionVanish();
+        }
+        Q_EMIT actionVanish(name);
+    }
+    Q_EMIT actionsChanged();
 }
 
 /*! \internal */
@@ -262,19 +351,26 @@ bool QDBusActionGroup::event(QEvent* e)
 {
     if (QDBusObject::event(e)) {
         return true;
-    } else if (e->type() == DBusActionVisiblityEvent::eventType) {
-        DBusActionVisiblityEvent *dave = static_cast<DBusActionVisiblityEvent*>(e);
-
-        if (dave->visible) {
-            Q_EMIT actionAppear(dave->name);
-        } else {
-            Q_EMIT actionVanish(dave->name);
-        }
-        Q_EMIT actionsChanged();
+    } else if (e->type() == DBusActionsAppearEvent::eventType) {
+        // an event left over from a previous group finds nothing to deliver
+        // and leaves the current one populating
+        flushAppearedActions();
+    } else if (e->type() == DBusActionsVanishEvent::eventType) {
+        flushVanishedActions();
     } else if (e->type() == DBusActionStateEvent::eventType) {
         DBusActionStateEvent *dase = static_cast<DBusActionStateEvent*>(e);
+        QStateAction *act = actionImpl(dase->name);
+
+        // only the action with that name gets the state, and it is converted
+        // once, when there is someone to deliver it to
+        if (act) {
+            act->onActionStateChanged(dase->state.toVariant());
+        }
 
-        Q_EMIT actionStateChanged(dase->name, dase->state);
+        static const QMetaMethod actionStateChangedSignal = QMetaMethod::fromSignal(&QDBusActionGroup::actionStateChanged);
+        if (isSignalConnected(actionStateChangedSignal)) {
+            Q_EMIT actionStateChanged(dase->name, dase->state.toVariant());
+        }
     }
     return QObject::event(e);
 }
@@ -284,8 +380,18 @@ void QDBusActionGroup::onActionAdded(GDBusActionGroup *, gchar *name, gpointer d
 {
     QDBusActionGroup *self = reinterpret_cast<QDBusActionGroup*>(data);
 
-    DBusActionVisiblityEvent dave(name, true);
-    QCoreApplication::sendEvent(self, &dave);
+    // keep the order of events for the actions removed before
+    self->flushVanishedActions();
+    self->m_appearedActions << QString::fromUtf8(name);
+
+    // GDBusActionGroup reports the initial actions of the remote group one
+    // by one, they are collected and delivered together from the event loop.
+    // Actions added later are delivered right away
+    if (!self->m_populating) {
+        self->flushAppearedActions();
+    } else if (self->m_appearedActions.size() == 1) {
+        QCoreApplication::postEvent(self, new DBusActionsAppearEvent);
+    }
 }
 
 /*! \internal */
@@ -293,15 +399,25 @@ void QDBusActionGroup::onActionRemoved(GDBusActionGroup *, gchar *name, gpointer
 {
     QDBusActionGroup *self = reinterpret_cast<QDBusActionGroup*>(data);
 
-    DBusActionVisiblityEvent dave(name, false);
-    QCoreApplication::sendEvent(self, &dave);
+    // keep the order of events for actions that are not delivered yet, and
+    // collect removals like additions, a group going away removes them all
+    self->flushAppearedActions();
+    if (self->m_vanishedActions.isEmpty()) {
+        QCoreApplication::postEvent(self, new DBusActionsVanishEvent);
+    }
+    self->m_vanishedActions << QString::fromUtf8(name);
 }
 
 /*! \internal */
 void QDBusActionGroup::onActionStateChanged(GDBusActionGroup *, gchar *name, GVariant *value, gpointer data)
 {
     QDBusActionGroup *self = reinterpret_cast<QDBusActionGroup*>(data);
+    const QString actionName = QString::fromUtf8(name);
+
+    if (!self->isStateObserved(actionName)) {
+        return;
+    }
 
-    DBusActionStateEvent dase(name, Converter::toQVariant(value));
+    DBusActionStateEvent dase(actionName, LazyVariant(value));
     QCoreApplication::sendEvent(self, &dase);
 }
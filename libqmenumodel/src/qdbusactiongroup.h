@@ -22,9 +22,11 @@
 
 #include "qdbusobject.h"
 
+#include <QHash>
 #include <QObject>
 #include <QVariant>
 
+class QDBusActionListModel;
 class QStateAction;
 class ActionStateParser;
 
@@ -43,12 +45,14 @@ class QDBusActionGroup : public QObject, public QDBusObject
     Q_PROPERTY(int status READ status NOTIFY statusChanged)
     Q_PROPERTY(ActionStateParser* actionStateParser READ actionStateParser WRITE setActionStateParser NOTIFY actionStateParserChanged)
     Q_PROPERTY(QStringList actions READ actions NOTIFY actionsChanged)
+    Q_PROPERTY(QDBusActionListModel* actionsModel READ actionsModel CONSTANT)
 
 public:
     QDBusActionGroup(QObject *parent=0);
     ~QDBusActionGroup();
 
     QStringList actions() const;
+    QDBusActionListModel *actionsModel() const;
     void updateActionState(const QString &name, const QVariant &state);
     void activateAction(const QString &name, const QVariant &parameter);
     bool hasAction(const QString &name);
@@ -83,17 +87,30 @@ protected:
 
 private:
     GActionGroup *m_actionGroup;
+    // whether the initial actions of the group are still to be delivered
+    bool m_populating;
     int m_signalActionAddId;
     int m_signalActionRemovedId;
     int m_signalStateChangedId;
 
     ActionStateParser* m_actionStateParser;
+    // names of the actions of the group, kept up to date as they come and go
+    QDBusActionListModel *m_actionsModel;
+    // actions added since the last DBusActionsAppearEvent was delivered
+    QStringList m_appearedActions;
+    // actions removed since the last DBusActionsVanishEvent was delivered
+    QStringList m_vanishedActions;
+    // the QStateActions created by action(), by name
+    QHash<QString, QStateAction*> m_actions;
 
     // workaround to support int as busType
     void setIntBusType(int busType);
 
     void setActionGroup(GDBusActionGroup *ag);
     QStateAction *actionImpl(const QString &name);
+    bool isStateObserved(const QString &name) const;
+    void flushAppearedActions();
+    void flushVanishedActions();
 
     void clear();
 
@@ -101,6 +118,8 @@ private:
     static void onActionAdded(GDBusActionGroup *ag, gchar *name, gpointer data);
     static void onActionRemoved(GDBusActionGroup *ag, gchar *name, gpointer data);
     static void onActionStateChanged(GDBusActionGroup *ag, gchar *name, GVariant *value, gpointer data);
+
+    friend class QStateAction;
 };
 
 #endif // QDBUSACTIONGROUP_H
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2012 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "qdbusactionlistmodel.h"
+
+/*!
+    \qmltype QDBusActionListModel
+
+    \brief The names of the actions of a \l QDBusActionGroup as a list model
+
+    The model is updated with a row insertion or removal for every action
+    that appears or vanishes, and with a single insertion for all actions
+    found when the group connects.
+
+    \code
+    ListView {
+        model: actionGroup.actionsModel
+        delegate: Text { text: name }
+    }
+    \endcode
+*/
+
+/*! \internal */
+QDBusActionListModel::QDBusActionListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+/*! \internal */
+QStringList QDBusActionListModel::actions() const
+{
+    return m_actions;
+}
+
+/*! \internal */
+bool QDBusActionListModel::contains(const QString &name) const
+{
+    return m_names.contains(name);
+}
+
+/*!
+    \qmlproperty int QDBusActionListModel::count
+    This property holds the number of actions
+*/
+int QDBusActionListModel::count() const
+{
+    return m_actions.count();
+}
+
+/*! \internal
+    Appends the actions of \a names that are not in the model yet, in one
+    row insertion.
+*/
+void QDBusActionListModel::appendActions(const QStringList &names)
+{
+    QStringList added;
+    Q_FOREACH(const QString &name, names) {
+        if (!m_names.contains(name)) {
+            m_names.insert(name);
+            added << name;
+        }
+    }
+
+    if (added.isEmpty()) {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), m_actions.count(), m_actions.count() + added.count() - 1);
+    m_actions << added;
+    endInsertRows();
+
+    Q_EMIT countChanged(m_actions.count());
+}
+
+/*! \internal
+    Removes the actions of \a names that are in the model, looking them up
+    in a single pass and removing each range of adjacent rows at once.
+*/
+void QDBusActionListModel::removeActions(const QStringList &names)
+{
+    int removed = 0;
+    Q_FOREACH(const QString &name, names) {
+        if (m_names.remove(name)) {
+            removed++;
+        }
+    }
+
+    if (removed == 0) {
+        return;
+    }
+
+    // rows whose name is no longer known, from the last to the first so
+    // that the rows still to be removed keep their position
+    int last = m_actions.count() - 1;
+    while (removed > 0) {
+        while (m_names.contains(m_actions.at(last))) {
+            last--;
+        }
+        int first = last;
+        while (first > 0 && !m_names.contains(m_actions.at(first - 1))) {
+            first--;
+        }
+
+        beginRemoveRows(QModelIndex(), first, last);
+        m_actions.erase(m_actions.begin() + first, m_actions.begin() + last + 1);
+        endRemoveRows();
+
+        removed -= last - first + 1;
+        last = first - 1;
+    }
+
+    Q_EMIT countChanged(m_actions.count());
+}
+
+/*! \internal */
+void QDBusActionListModel::clear()
+{
+    if (m_actions.isEmpty()) {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), 0, m_actions.count() - 1);
+    m_actions.clear();
+    m_names.clear();
+    endRemoveRows();
+
+    Q_EMIT countChanged(0);
+}
+
+/*! \internal */
+int QDBusActionListModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_actions.count();
+}
+
+/*! \internal */
+QVariant QDBusActionListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_actions.count() || role != NameRole) {
+        return QVariant();
+    }
+    return m_actions.at(index.row());
+}
+
+/*! \internal */
+QHash<int, QByteArray> QDBusActionListModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles[NameRole] = "name";
+    return roles;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2012 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef QDBUSACTIONLISTMODEL_H
+#define QDBUSACTIONLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QSet>
+#include <QStringList>
+
+class QDBusActionListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum ActionRoles {
+        NameRole = Qt::DisplayRole
+    };
+
+    QDBusActionListModel(QObject *parent = 0);
+
+    QStringList actions() const;
+    bool contains(const QString &name) const;
+    int count() const;
+
+    void appendActions(const QStringList &names);
+    void removeActions(const QStringList &names);
+    void clear();
+
+    /* QAbstractItemModel */
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QHash<int, QByteArray> roleNames() const;
+
+Q_SIGNALS:
+    void countChanged(int count);
+
+private:
+    QStringList m_actions;
+    QSet<QString> m_names;
+};
+
+#endif // QDBUSACTIONLISTMODEL_H
@@ -41,7 +41,8 @@ extern "C" {
 /*! \internal */
 QMenuModel::QMenuModel(GMenuModel *other, QObject *parent)
     : QAbstractItemModel(parent),
-      m_root(0)
+      m_root(0),
+      m_lazyLoading(false)
 {
     setMenuModel(other);
 }
@@ -64,12 +65,47 @@ void QMenuModel::setMenuModel(GMenuModel *other)
     clearModel();
 
     if (other) {
-        m_root = new MenuNode("", other, 0, 0, this);
+        m_root = new MenuNode("", other, 0, 0, this, m_lazyLoading);
     }
 
     endResetModel();
 }
 
+/*!
+    \qmlproperty bool QMenuModel::lazyLoading
+    When true, sections and submenus are only read when a view fetches them
+    with fetchMore(), so that a remote menu is not subscribed to as a whole.
+    Until then they have no rows. The rows of a remote menu read this way
+    arrive later, with a row insertion. False by default, which reads the
+    whole menu up front.
+*/
+bool QMenuModel::lazyLoading() const
+{
+    return m_lazyLoading;
+}
+
+void QMenuModel::setLazyLoading(bool lazy)
+{
+    if (m_lazyLoading == lazy) {
+        return;
+    }
+    m_lazyLoading = lazy;
+
+    // build the tree again in the new mode
+    if (m_root) {
+        GMenuModel *model = G_MENU_MODEL(g_object_ref(m_root->model()));
+
+        beginResetModel();
+        clearModel();
+        m_root = new MenuNode("", model, 0, 0, this, m_lazyLoading);
+        endResetModel();
+
+        g_object_unref(model);
+    }
+
+    Q_EMIT lazyLoadingChanged(m_lazyLoading);
+}
+
 /*! \internal */
 void QMenuModel::clearModel()
 {
@@ -138,14 +174,10 @@ QVariant QMenuModel::data(const QModelIndex &index, int role) const
     if (row >= 0) {
         switch (role) {
         case Action:
-            attribute = getStringAttribute(node, row, G_MENU_ATTRIBUTE_ACTION);
-            break;
         case Qt::DisplayRole:
         case Label:
-            attribute = getStringAttribute(node, row, G_MENU_ATTRIBUTE_LABEL);
-            break;
         case Extra:
-            attribute = getExtraProperties(node, row);
+            attribute = itemAttribute(node, index.row(), row, role);
             break;
         case hasSection:
             attribute = QVariant(hasLink(node, row, G_MENU_LINK_SECTION));
@@ -167,12 +199,11 @@ QVariant QMenuModel::data(const QModelIndex &index, int role) const
 int QMenuModel::rowCount(const QModelIndex &index) const
 {
     if (index.isValid()) {
-        MenuNode *node = nodeFromIndex(index);
-        if (node) {
-            MenuNode *child = node->child(index.row());
-            if (child) {
-                return child->size();
-            }
+        MenuNode *child = childFromIndex(index);
+        // the items of a link that was not fetched yet are not read here,
+        // fetchMore announces them
+        if (child && child->isPopulated()) {
+            return child->size();
         }
         return 0;
     }
@@ -188,16 +219,90 @@ int QMenuModel::columnCount(const QModelIndex &) const
     return 1;
 }
 
+/*! \internal */
+bool QMenuModel::hasChildren(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return (rowCount() > 0);
+    }
+
+    MenuNode *child = childFromIndex(parent);
+    if (child) {
+        return (!child->isPopulated() || (child->size() > 0));
+    }
+    return false;
+}
+
+/*! \internal */
+bool QMenuModel::canFetchMore(const QModelIndex &parent) const
+{
+    MenuNode *child = childFromIndex(parent);
+    return (child && !child->isPopulated());
+}
+
+/*! \internal
+    In a lazy model, sections and submenus are read when a view expands them.
+*/
+void QMenuModel::fetchMore(const QModelIndex &parent)
+{
+    MenuNode *child = childFromIndex(parent);
+    if ((child == 0) || child->isPopulated()) {
+        return;
+    }
+
+    int count = g_menu_model_get_n_items(child->model());
+    if (count > 0) {
+        beginInsertRows(parent, 0, count - 1);
+        child->populate();
+        endInsertRows();
+    } else {
+        child->populate();
+    }
+}
+
+/*! \internal
+    Returns the decoded attribute of the item at \a pos of \a node, which is
+    read from \a row of the menu model only the first time.
+*/
+QVariant QMenuModel::itemAttribute(MenuNode *node, int pos, int row, int role) const
+{
+    if (role == Qt::DisplayRole) {
+        role = Label;
+    }
+
+    QVariant attribute;
+    if (node->cachedAttribute(pos, role, &attribute)) {
+        return attribute;
+    }
+
+    switch (role) {
+    case Action:
+        attribute = getStringAttribute(node, row, G_MENU_ATTRIBUTE_ACTION);
+        break;
+    case Label:
+        attribute = getStringAttribute(node, row, G_MENU_ATTRIBUTE_LABEL);
+        break;
+    case Extra:
+        attribute = getExtraProperties(node, row);
+        break;
+    default:
+        return attribute;
+    }
+
+    node->cacheAttribute(pos, role, attribute);
+    return attribute;
+}
+
 /*! \internal */
 QVariant QMenuModel::getStringAttribute(MenuNode *node,
                                         int row,
-                                        const QString &attribute) const
+                                        const char *attribute) const
 {
     QVariant result;
     gchar* value = NULL;
     g_menu_model_get_item_attribute(node->model(),
                                     row,
-                                    attribute.toUtf8().data(),
+                                    attribute,
                                     "s", &value);
     if (value) {
         result = QVariant(QString::fromUtf8(value));
@@ -222,7 +327,9 @@ QVariant QMenuModel::getExtraProperties(MenuNode *node, int row) const
             extra.insert(parseExtraPropertyName(attrName),
                          Converter::toQVariant(value));
         }
+        g_variant_unref(value);
     }
+    g_object_unref(iter);
 
     return extra;
 }
@@ -266,7 +373,7 @@ QModelIndex QMenuModel::indexFromNode(MenuNode *node) const
     if (node == m_root) {
         return QModelIndex();
     }
-    return createIndex(node->position(), 0, node);
+    return createIndex(node->position(), 0, node->parent());
 }
 
 /*! \internal */
@@ -283,6 +390,17 @@ MenuNode *QMenuModel::nodeFromIndex(const QModelIndex &index) const
     return node;
 }
 
+/*! \internal */
+MenuNode *QMenuModel::childFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return 0;
+    }
+
+    MenuNode *node = nodeFromIndex(index);
+    return node ? node->child(index.row()) : 0;
+}
+
 /*! \internal */
 QString QMenuModel::parseExtraPropertyName(const QString &name) const
 {
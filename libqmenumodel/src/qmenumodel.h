@@ -28,6 +28,7 @@ typedef struct _GMenuModel GMenuModel;
 class QMenuModel : public QAbstractItemModel
 {
     Q_OBJECT
+    Q_PROPERTY(bool lazyLoading READ lazyLoading WRITE setLazyLoading NOTIFY lazyLoadingChanged)
 
 public:
     enum MenuRoles {
@@ -41,16 +42,23 @@ public:
 
     ~QMenuModel();
 
+    bool lazyLoading() const;
+    void setLazyLoading(bool lazy);
+
     /* QAbstractItemModel */
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
     QModelIndex index(int row, int column = 0, const QModelIndex &parent = QModelIndex()) const;
     QModelIndex parent(const QModelIndex &index) const;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const;
+    bool canFetchMore(const QModelIndex &parent) const;
+    void fetchMore(const QModelIndex &parent);
     QHash<int, QByteArray> roleNames() const;
 
 Q_SIGNALS:
     void countChanged();
+    void lazyLoadingChanged(bool lazy);
 
 protected:
     QMenuModel(GMenuModel *other=0, QObject *parent=0);
@@ -61,11 +69,14 @@ protected:
 
 private:
     MenuNode *m_root;
+    bool m_lazyLoading;
 
     MenuNode* nodeFromIndex(const QModelIndex &index) const;
+    MenuNode* childFromIndex(const QModelIndex &index) const;
     QModelIndex indexFromNode(MenuNode *node) const;
 
-    QVariant getStringAttribute(MenuNode *node, int row, const QString &attribute) const;
+    QVariant itemAttribute(MenuNode *node, int pos, int row, int role) const;
+    QVariant getStringAttribute(MenuNode *node, int row, const char *attribute) const;
     QVariant getExtraProperties(MenuNode *node, int row) const;
     bool hasLink(MenuNode *node, int row, const QString &linkType) const;
 
@@ -26,7 +26,8 @@ extern "C" {
 
 const QEvent::Type MenuNodeItemChangeEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type DBusActionStateEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
-const QEvent::Type DBusActionVisiblityEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+const QEvent::Type DBusActionsAppearEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+const QEvent::Type DBusActionsVanishEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type MenuModelEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type DbusObjectServiceEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 
@@ -46,14 +47,18 @@ DBusActionEvent::DBusActionEvent(const QString& _name, QEvent::Type type)
 }
 
 
-DBusActionVisiblityEvent::DBusActionVisiblityEvent(const QString& _name, bool _visible)
-    : DBusActionEvent(_name, DBusActionVisiblityEvent::eventType),
-      visible(_visible)
+DBusActionsAppearEvent::DBusActionsAppearEvent()
+    : QEvent(DBusActionsAppearEvent::eventType)
+{
+}
+
+DBusActionsVanishEvent::DBusActionsVanishEvent()
+    : QEvent(DBusActionsVanishEvent::eventType)
 {
 }
 
 
-DBusActionStateEvent::DBusActionStateEvent(const QString& _name, const QVariant& _state)
+DBusActionStateEvent::DBusActionStateEvent(const QString& _name, const LazyVariant& _state)
     : DBusActionEvent(_name, DBusActionStateEvent::eventType),
       state(_state)
 {
@@ -20,6 +20,8 @@
 #ifndef QMENUMODELEVENTS_H
 #define QMENUMODELEVENTS_H
 
+#include "lazyvariant.h"
+
 #include <QEvent>
 #include <QVariant>
 
@@ -61,14 +63,20 @@ protected:
     DBusActionEvent(const QString& name, QEvent::Type type);
 };
 
-/* Event for a GAction add/remove */
-class DBusActionVisiblityEvent : public DBusActionEvent
+/* Event for delivering the initial GActions of a group, all at once */
+class DBusActionsAppearEvent : public QEvent
 {
 public:
     static const QEvent::Type eventType;
-    DBusActionVisiblityEvent(const QString& name, bool visible);
+    DBusActionsAppearEvent();
+};
 
-    bool visible;
+/* Event for delivering the GActions removed since it was posted, all at once */
+class DBusActionsVanishEvent : public QEvent
+{
+public:
+    static const QEvent::Type eventType;
+    DBusActionsVanishEvent();
 };
 
 /* Event for a GAction state value update */
@@ -77,9 +85,9 @@ class DBusActionStateEvent : public DBusActionEvent
 public:
     static const QEvent::Type eventType;
 
-    DBusActionStateEvent(const QString& name, const QVariant& state);
+    DBusActionStateEvent(const QString& name, const LazyVariant& state);
 
-    QVariant state;
+    LazyVariant state;
 };
 
 /* Event for changing gmenumodel entries */
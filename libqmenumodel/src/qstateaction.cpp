@@ -52,23 +52,20 @@ QStateAction::QStateAction(QDBusActionGroup *group, const QString &name)
       m_group(group),
       m_name(name)
 {
-    // This keep the code clean
-    // But maybe we need move the action state control to QActionGroup to optimizations
-    QObject::connect(m_group, SIGNAL(actionAppear(QString)),
-                     this, SLOT(onActionAppear(QString)));
-    QObject::connect(m_group, SIGNAL(actionVanish(QString)),
-                     this, SLOT(onActionVanish(QString)));
-    QObject::connect(m_group, SIGNAL(actionStateChanged(QString,QVariant)),
-                     this, SLOT(onActionStateChanged(QString,QVariant)));
-
-
-
+    // the group delivers the events of this action directly, see
+    // QDBusActionGroup::event
     m_valid = m_group->hasAction(name);
     if (m_valid) {
         setState(m_group->actionState(name));
     }
 }
 
+/*! \internal */
+QStateAction::~QStateAction()
+{
+    m_group->m_actions.remove(m_name);
+}
+
 /*!
     \qmlproperty int QStateAction::state
     This property holds the current action state
@@ -78,6 +75,16 @@ QVariant QStateAction::state() const
     return m_state;
 }
 
+/*!
+    \qmlproperty list<string> QStateAction::changedStateKeys
+    This property holds the keys of a dictionary state that changed with the
+    last state update. It is empty when the state is not a dictionary.
+*/
+QStringList QStateAction::changedStateKeys() const
+{
+    return m_changedStateKeys;
+}
+
 /*!
     \qmlproperty int QStateAction::isValid
     This property return if the current Action is valid or not
@@ -142,38 +149,80 @@ void QStateAction::setValid(bool valid)
     }
 }
 
+/*! \internal
+    Moves the unchanged entries of \a previous into \a current, so that they
+    keep sharing their data, and returns the keys that changed.
+*/
+static QStringList mergeStates(const QVariantMap &previous, QVariantMap &current)
+{
+    QStringList changed;
+
+    QVariantMap::iterator it = current.begin();
+    for (; it != current.end(); ++it) {
+        QVariantMap::const_iterator old = previous.constFind(it.key());
+        if (old != previous.constEnd() && old.value() == it.value()) {
+            it.value() = old.value();
+        } else {
+            changed << it.key();
+        }
+    }
+
+    QVariantMap::const_iterator old = previous.constBegin();
+    for (; old != previous.constEnd(); ++old) {
+        if (!current.contains(old.key())) {
+            changed << old.key();
+        }
+    }
+
+    return changed;
+}
+
 /*! \internal */
 void QStateAction::setState(const QVariant &state)
 {
     QVariant v = state;
-    if (!m_state.isValid() || (v.convert(m_state.type()) && v != m_state)) {
-        m_state = v;
-        Q_EMIT stateChanged(m_state);
+    if (m_state.isValid() && !v.convert(m_state.type())) {
+        return;
     }
+
+    QStringList changed;
+    if (!m_state.isValid()) {
+        if (v.type() == QVariant::Map) {
+            changed = v.toMap().keys();
+        }
+    } else if (v.type() == QVariant::Map) {
+        // compare dictionaries key by key, this replaces the full comparison
+        QVariantMap map = v.toMap();
+        changed = mergeStates(m_state.toMap(), map);
+        if (changed.isEmpty()) {
+            return;
+        }
+        v = map;
+    } else if (v == m_state) {
+        return;
+    }
+
+    m_changedStateKeys = changed;
+    m_state = v;
+    Q_EMIT stateChanged(m_state);
 }
 
 /*! \internal */
-void QStateAction::onActionAppear(const QString &name)
+void QStateAction::onActionAppear()
 {
-    if (m_name == name) {
-        setState(m_group->actionState(name));
-        setValid(true);
-    }
+    setState(m_group->actionState(m_name));
+    setValid(true);
 }
 
 /*! \internal */
-void QStateAction::onActionVanish(const QString &name)
+void QStateAction::onActionVanish()
 {
-    if (m_name == name) {
-        setState(QVariant());
-        setValid(false);
-    }
+    setState(QVariant());
+    setValid(false);
 }
 
 /*! \internal */
-void QStateAction::onActionStateChanged(const QString &name, const QVariant &state)
+void QStateAction::onActionStateChanged(const QVariant &state)
 {
-    if (m_name == name) {
-        setState(state);
-    }
+    setState(state);
 }
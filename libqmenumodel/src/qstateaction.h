@@ -21,6 +21,7 @@
 #define QDBUSACTION_H
 
 #include <QObject>
+#include <QStringList>
 #include <QVariant>
 
 class QDBusActionGroup;
@@ -30,9 +31,13 @@ class QStateAction : public QObject
     Q_OBJECT
     Q_PROPERTY(QString name READ name)
     Q_PROPERTY(QVariant state READ state NOTIFY stateChanged)
+    Q_PROPERTY(QStringList changedStateKeys READ changedStateKeys NOTIFY stateChanged)
     Q_PROPERTY(bool valid READ isValid NOTIFY validChanged)
 public:
+    ~QStateAction();
+
     QVariant state() const;
+    QStringList changedStateKeys() const;
     bool isValid() const;
 
     Q_INVOKABLE void activate(const QVariant &parameter = QVariant());
@@ -44,14 +49,10 @@ Q_SIGNALS:
     void stateChanged(QVariant state);
     void validChanged(bool valid);
 
-private Q_SLOTS:
-    void onActionAppear(const QString &name);
-    void onActionVanish(const QString &name);
-    void onActionStateChanged(const QString &name, const QVariant &state);
-
 private:
     QDBusActionGroup *m_group;
     QVariant m_state;
+    QStringList m_changedStateKeys;
     bool m_valid;
     QString m_name;
 
@@ -61,6 +62,11 @@ private:
     void setState(const QVariant &state);
     QString name() const;
 
+    // called by the group for the events of this action
+    void onActionAppear();
+    void onActionVanish();
+    void onActionStateChanged(const QVariant &state);
+
     friend class QDBusActionGroup;
 };
 
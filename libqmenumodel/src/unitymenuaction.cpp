@@ -20,6 +20,8 @@
 #include "unitymenumodel.h"
 #include "unitymenuactionevents.h"
 
+#include <QMetaMethod>
+
 UnityMenuAction::UnityMenuAction(QObject* parent)
     :   QObject(parent),
         m_valid(false),
@@ -63,15 +65,36 @@ void UnityMenuAction::setModel(UnityMenuModel* model)
 }
 
 QVariant UnityMenuAction::state() const
+{
+    return m_state.toVariant();
+}
+
+LazyVariant UnityMenuAction::lazyState() const
 {
     return m_state;
 }
 
-void UnityMenuAction::setState(const QVariant& state)
+/* The keys of a vardict state that changed with the last update. Empty when
+ * the state is not a vardict. Only compared when asked for. */
+QStringList UnityMenuAction::changedStateKeys() const
+{
+    return m_state.changedKeys(m_previousState);
+}
+
+void UnityMenuAction::setState(const LazyVariant& state)
 {
     if (m_state != state) {
+        m_previousState = m_state;
         m_state = state;
-        Q_EMIT stateChanged(m_state);
+        m_state.setPrevious(m_previousState);
+
+        Q_EMIT lazyStateChanged();
+
+        /* the state is only converted when someone listens for it */
+        static const QMetaMethod stateChangedSignal = QMetaMethod::fromSignal(&UnityMenuAction::stateChanged);
+        if (isSignalConnected(stateChangedSignal)) {
+            Q_EMIT stateChanged(m_state.toVariant());
+        }
     }
 }
 
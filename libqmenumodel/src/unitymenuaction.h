@@ -19,6 +19,8 @@
 #ifndef UNITYMENUACTION_H
 #define UNITYMENUACTION_H
 
+#include "lazyvariant.h"
+
 #include <QObject>
 #include <QVariant>
 class UnityMenuModel;
@@ -29,6 +31,8 @@ class UnityMenuAction: public QObject
 
     Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
     Q_PROPERTY(QVariant state READ state NOTIFY stateChanged)
+    Q_PROPERTY(LazyVariant lazyState READ lazyState NOTIFY lazyStateChanged)
+    Q_PROPERTY(QStringList changedStateKeys READ changedStateKeys NOTIFY lazyStateChanged)
     Q_PROPERTY(bool enabled READ isEnabled NOTIFY enabledChanged)
     Q_PROPERTY(bool valid READ isValid NOTIFY validChanged)
     Q_PROPERTY(UnityMenuModel* model READ model WRITE setModel NOTIFY modelChanged)
@@ -48,6 +52,8 @@ public:
     void setIndex(int i);
 
     QVariant state() const;
+    LazyVariant lazyState() const;
+    QStringList changedStateKeys() const;
     bool isEnabled() const;
     bool isValid() const;
 
@@ -58,6 +64,7 @@ Q_SIGNALS:
     void nameChanged(const QString& name);
     void modelChanged(UnityMenuModel* model);
     void stateChanged(const QVariant& name);
+    void lazyStateChanged();
     void enabledChanged(bool enabled);
     void validChanged(bool valid);
     void indexChanged(int index);
@@ -65,7 +72,7 @@ Q_SIGNALS:
 protected:
     virtual bool event(QEvent* e);
 
-    void setState(const QVariant& state);
+    void setState(const LazyVariant& state);
     void setEnabled(bool enabled);
     void setValid(bool valid);
 
@@ -74,7 +81,8 @@ private:
     void registerAction();
 
     QString m_name;
-    QVariant m_state;
+    LazyVariant m_state;
+    LazyVariant m_previousState;
     bool m_valid;
     bool m_enabled;
     UnityMenuModel* m_model;
@@ -24,7 +24,7 @@ const QEvent::Type UnityMenuActionRemoveEvent::eventType = static_cast<QEvent::T
 const QEvent::Type UnityMenuActionEnabledChangedEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type UnityMenuActionStateChangeEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 
-UnityMenuActionAddEvent::UnityMenuActionAddEvent(bool _enabled, const QVariant& _state)
+UnityMenuActionAddEvent::UnityMenuActionAddEvent(bool _enabled, const LazyVariant& _state)
     : QEvent(UnityMenuActionAddEvent::eventType),
       enabled(_enabled),
       state(_state)
@@ -40,7 +40,7 @@ UnityMenuActionEnabledChangedEvent::UnityMenuActionEnabledChangedEvent(bool _ena
       enabled(_enabled)
 {}
 
-UnityMenuActionStateChangeEvent::UnityMenuActionStateChangeEvent(const QVariant& _state)
+UnityMenuActionStateChangeEvent::UnityMenuActionStateChangeEvent(const LazyVariant& _state)
     : QEvent(UnityMenuActionStateChangeEvent::eventType),
       state(_state)
 {}
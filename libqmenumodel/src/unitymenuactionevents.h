@@ -20,18 +20,19 @@
 #ifndef UNITYMENUACTIONEVENTS_H
 #define UNITYMENUACTIONEVENTS_H
 
+#include "lazyvariant.h"
+
 #include <QEvent>
-#include <QVariant>
 
 /* Event for a unitymenuaction add */
 class UnityMenuActionAddEvent : public QEvent
 {
 public:
     static const QEvent::Type eventType;
-    UnityMenuActionAddEvent(bool enabled, const QVariant& state);
+    UnityMenuActionAddEvent(bool enabled, const LazyVariant& state);
 
     bool enabled;
-    QVariant state;
+    LazyVariant state;
 };
 
 /* Event for a unitymenuaction remove */
@@ -57,9 +58,9 @@ class UnityMenuActionStateChangeEvent : public QEvent
 {
 public:
     static const QEvent::Type eventType;
-    UnityMenuActionStateChangeEvent(const QVariant& state);
+    UnityMenuActionStateChangeEvent(const LazyVariant& state);
 
-    QVariant state;
+    LazyVariant state;
 };
 
 #endif //UNITYMENUACTIONEVENTS_H
@@ -17,17 +17,19 @@
  */
 
 #include "unitymenumodel.h"
+#include "unitymenumodelrow.h"
 #include "converter.h"
 #include "actionstateparser.h"
 #include "unitymenumodelevents.h"
 #include "unitymenuaction.h"
 #include "unitymenuactionevents.h"
+#include "iconcache.h"
 #include "logging.h"
 
-#include <QIcon>
 #include <QQmlComponent>
 #include <QCoreApplication>
 #include <QKeySequence>
+#include <QPointer>
 
 extern "C" {
   #include "gtk/gtkactionmuxer.h"
@@ -37,26 +39,61 @@ extern "C" {
 
 Q_LOGGING_CATEGORY(unitymenumodel, "qmenumodel.unitymenumodel", QtCriticalMsg)
 
-G_DEFINE_QUARK (UNITY_MENU_MODEL, unity_menu_model)
 G_DEFINE_QUARK (UNITY_SUBMENU_MODEL, unity_submenu_model)
 G_DEFINE_QUARK (UNITY_MENU_ITEM_EXTENDED_ATTRIBUTES, unity_menu_item_extended_attributes)
 G_DEFINE_QUARK (UNITY_MENU_ACTION, unity_menu_action)
 
 
-enum MenuRoles {
-    LabelRole  = Qt::DisplayRole + 1,
-    SensitiveRole,
-    IsSeparatorRole,
-    IconRole,
-    TypeRole,
-    ExtendedAttributesRole,
-    ActionRole,
-    ActionStateRole,
-    IsCheckRole,
-    IsRadioRole,
-    IsToggledRole,
-    ShortcutRole,
-    HasSubmenuRole
+
+// number of compiled extended attribute schemas kept per model
+static const int MaxCachedSchemas = 16;
+
+/* A schema passed to loadExtendedAttributes, compiled so that loading the
+ * attributes of a row does not need to parse it again. */
+struct ExtendedAttributeSchema
+{
+    enum Type {
+        Invalid,
+        Int,
+        Int64,
+        Bool,
+        String,
+        Double,
+        Variant,
+        Icon
+    };
+
+    struct Attribute {
+        QByteArray name;        // attribute name in the menu item
+        QString key;            // qtified name used in the result
+        QByteArray typeName;
+        Type type;
+    };
+
+    ExtendedAttributeSchema(const QVariantMap &schema);
+
+    static uint hash(const QVariantMap &schema);
+
+    QVariantMap source;
+    uint sourceHash;
+    QVector<Attribute> attributes;
+};
+
+/* The extended attributes loaded for a menu item, kept as its qdata. Icon
+ * uris among them are held until the attributes are dropped. */
+struct ExtendedAttributes
+{
+    QVariantMap values;
+    QStringList iconUris;
+};
+
+/* A parser created from a QQmlComponent passed to submenu(). The component
+ * is tracked so that a new component at the same address is not mistaken
+ * for it. */
+struct ComponentParser
+{
+    QPointer<QQmlComponent> component;
+    ActionStateParser *parser;
 };
 
 class UnityMenuModelPrivate
@@ -70,12 +107,25 @@ public:
     void clearName();
     void updateActions();
     void updateMenuModel();
-    QVariant itemState(GtkMenuTrackerItem *item);
+    QVariant itemState(UnityMenuModelRow *row);
+
+    UnityMenuModelRow *row(int position) const;
+    GtkMenuTrackerItem *item(int position) const;
+    void insertRows(int position, GPtrArray *items);
+    void removeRows(int position, int count);
+    void updatePositions(int from);
+
+    void addDataChange(int position, const QVector<int> &roles);
+    void flushDataChanges();
+
+    const ExtendedAttributeSchema *compiledSchema(const QVariantMap &schema);
+    bool loadTypeAttributes(UnityMenuModelRow *row);
+    ActionStateParser *componentParser(QQmlComponent *component);
 
     UnityMenuModel *model;
     GtkActionMuxer *muxer;
     GtkMenuTracker *menutracker;
-    GSequence *items;
+    QVector<UnityMenuModelRow*> rows;
     GDBusConnection *connection;
     QByteArray busName;
     QByteArray nameOwner;
@@ -84,8 +134,21 @@ public:
     QByteArray menuObjectPath;
     QHash<QByteArray, int> roles;
     ActionStateParser* actionStateParser;
+    // parsers created for submenus, one per component, owned by the model
+    QHash<QQmlComponent*, ComponentParser> componentParsers;
     QHash<UnityMenuAction*, GtkSimpleActionObserver*> registeredActions;
     bool destructorGuard;
+    // compiled schemas by the hash of their source, least recently used first
+    // in schemaOrder
+    QMultiHash<uint, ExtendedAttributeSchema*> schemas;
+    QList<ExtendedAttributeSchema*> schemaOrder;
+    // schemas loaded automatically for rows of a given x-canonical-type
+    QHash<QString, ExtendedAttributeSchema*> typeSchemas;
+
+    // rows whose data changed since the last flush, with a mask of the changed roles
+    QMap<int, quint32> dirtyRows;
+    bool coalesceDataChanges;
+    bool flushPending;
 
     static void nameAppeared(GDBusConnection *connection, const gchar *name, const gchar *owner, gpointer user_data);
     static void nameVanished(GDBusConnection *connection, const gchar *name, gpointer user_data);
@@ -105,12 +168,14 @@ public:
     void updateRegisteredAction(UnityMenuAction *action);
 };
 
-void menu_item_free (gpointer data)
+static void menu_item_row_free (UnityMenuModelRow *row)
 {
-    GtkMenuTrackerItem *item = (GtkMenuTrackerItem *) data;
-
-    g_signal_handlers_disconnect_by_func (item, (gpointer) UnityMenuModelPrivate::menuItemChanged, NULL);
-    g_object_unref (item);
+    g_signal_handler_disconnect (row->item, row->notifyId);
+    g_object_unref (row->item);
+    if (row->state)
+        g_variant_unref (row->state);
+    IconCache::releaseIconUri (row->icon);
+    delete row;
 }
 
 UnityMenuModelPrivate::UnityMenuModelPrivate(UnityMenuModel *model)
@@ -119,12 +184,12 @@ UnityMenuModelPrivate::UnityMenuModelPrivate(UnityMenuModel *model)
     this->menutracker = NULL;
     this->connection = NULL;
     this->nameWatchId = 0;
-    this->actionStateParser = new ActionStateParser(model);
+    this->actionStateParser = ActionStateParser::sharedParser();
     this->destructorGuard = false;
+    this->coalesceDataChanges = true;
+    this->flushPending = false;
 
     this->muxer = gtk_action_muxer_new ();
-
-    this->items = g_sequence_new (menu_item_free);
 }
 
 UnityMenuModelPrivate::UnityMenuModelPrivate(const UnityMenuModelPrivate& other, UnityMenuModel *model)
@@ -133,12 +198,16 @@ UnityMenuModelPrivate::UnityMenuModelPrivate(const UnityMenuModelPrivate& other,
     this->menutracker = NULL;
     this->connection = NULL;
     this->nameWatchId = 0;
-    this->actionStateParser = new ActionStateParser(model);
+    this->actionStateParser = ActionStateParser::sharedParser();
     this->destructorGuard = false;
+    this->coalesceDataChanges = other.coalesceDataChanges;
+    this->flushPending = false;
 
     this->muxer = GTK_ACTION_MUXER( g_object_ref(other.muxer));
 
-    this->items = g_sequence_new (menu_item_free);
+    QHash<QString, ExtendedAttributeSchema*>::const_iterator it = other.typeSchemas.constBegin();
+    for (; it != other.typeSchemas.constEnd(); ++it)
+        this->typeSchemas.insert(it.key(), new ExtendedAttributeSchema(it.value()->source));
 }
 
 UnityMenuModelPrivate::~UnityMenuModelPrivate()
@@ -146,7 +215,6 @@ UnityMenuModelPrivate::~UnityMenuModelPrivate()
     this->destructorGuard = true;
     this->clearItems(false);
 
-    g_sequence_free(this->items);
     g_clear_pointer (&this->menutracker, gtk_menu_tracker_free);
     g_clear_object (&this->muxer);
     g_clear_object (&this->connection);
@@ -158,6 +226,9 @@ UnityMenuModelPrivate::~UnityMenuModelPrivate()
     }
     this->registeredActions.clear();
 
+    qDeleteAll(this->schemas);
+    qDeleteAll(this->typeSchemas);
+
     if (this->nameWatchId)
         g_bus_unwatch_name (this->nameWatchId);
 }
@@ -215,21 +286,148 @@ void UnityMenuModelPrivate::updateMenuModel()
     }
 }
 
-QVariant UnityMenuModelPrivate::itemState(GtkMenuTrackerItem *item)
+QVariant UnityMenuModelPrivate::itemState(UnityMenuModelRow *row)
 {
-    QVariant result;
+    GVariant *state = gtk_menu_tracker_item_get_action_state (row->item);
+    if (state == NULL || actionStateParser == NULL) {
+        if (state)
+            g_variant_unref (state);
+        return QVariant();
+    }
 
-    GVariant *state = gtk_menu_tracker_item_get_action_state (item);
-    if (state != NULL) {
-        if (actionStateParser != NULL) {
-            result = actionStateParser->toQVariant(state);
-        }
+    if (row->state && g_variant_equal (row->state, state)) {
         g_variant_unref (state);
+        return row->stateValue;
     }
 
+    gchar *action_name = gtk_menu_tracker_item_get_action_name (row->item);
+    QVariant result = actionStateParser->parseState (action_name, state, row->state, row->stateValue);
+    g_free (action_name);
+
+    if (row->state)
+        g_variant_unref (row->state);
+    row->state = state;
+    row->stateValue = result;
+
     return result;
 }
 
+UnityMenuModelRow * UnityMenuModelPrivate::row(int position) const
+{
+    if (position < 0 || position >= this->rows.size())
+        return NULL;
+
+    return this->rows.at(position);
+}
+
+GtkMenuTrackerItem * UnityMenuModelPrivate::item(int position) const
+{
+    UnityMenuModelRow *row = this->row(position);
+    return row ? row->item : NULL;
+}
+
+void UnityMenuModelPrivate::insertRows(int position, GPtrArray *items)
+{
+    this->rows.insert(position, (int) items->len, NULL);
+
+    for (guint i = 0; i < items->len; ++i) {
+        UnityMenuModelRow *row = new UnityMenuModelRow;
+
+        row->item = (GtkMenuTrackerItem *) g_object_ref (g_ptr_array_index (items, i));
+        row->priv = this;
+        row->cached = 0;
+        row->iconGeneration = 0;
+        row->hasSubmenu = false;
+        row->state = NULL;
+        row->notifyId = g_signal_connect (row->item, "notify", G_CALLBACK (menuItemChanged), row);
+        this->rows[position + i] = row;
+    }
+
+    this->updatePositions(position);
+}
+
+void UnityMenuModelPrivate::removeRows(int position, int count)
+{
+    count = qMin(count, this->rows.size() - position);
+    if (position < 0 || count <= 0)
+        return;
+
+    for (int i = position; i < position + count; ++i)
+        menu_item_row_free (this->rows.at(i));
+    this->rows.remove(position, count);
+
+    this->updatePositions(position);
+}
+
+void UnityMenuModelPrivate::updatePositions(int from)
+{
+    for (int i = from; i < this->rows.size(); ++i)
+        this->rows.at(i)->position = i;
+}
+
+static const quint32 AllRolesMask = ~0u;
+
+static quint32 rolesToMask(const QVector<int> &roles)
+{
+    if (roles.isEmpty())
+        return AllRolesMask;
+
+    quint32 mask = 0;
+    Q_FOREACH (int role, roles)
+        mask |= 1u << (role - LabelRole);
+    return mask;
+}
+
+static QVector<int> maskToRoles(quint32 mask)
+{
+    QVector<int> roles;
+
+    if (mask == AllRolesMask)
+        return roles;
+
+    for (int role = LabelRole; role <= HasSubmenuRole; ++role) {
+        if (mask & (1u << (role - LabelRole)))
+            roles << role;
+    }
+    return roles;
+}
+
+/* Records a data change for @position. Changes are collected and emitted
+ * as merged ranges once the event loop gets back to the model. */
+void UnityMenuModelPrivate::addDataChange(int position, const QVector<int> &roles)
+{
+    this->dirtyRows[position] |= rolesToMask(roles);
+
+    if (!this->flushPending) {
+        this->flushPending = true;
+        QCoreApplication::postEvent(this->model, new UnityMenuModelFlushEvent);
+    }
+}
+
+void UnityMenuModelPrivate::flushDataChanges()
+{
+    if (this->dirtyRows.isEmpty())
+        return;
+
+    // take the pending changes first, dataChanged handlers may cause new ones
+    QMap<int, quint32> dirty;
+    dirty.swap(this->dirtyRows);
+
+    QMap<int, quint32>::const_iterator it = dirty.constBegin();
+    while (it != dirty.constEnd()) {
+        int first = it.key();
+        int last = first;
+        quint32 mask = it.value();
+
+        for (++it; it != dirty.constEnd() && it.key() == last + 1; ++it) {
+            last = it.key();
+            mask |= it.value();
+        }
+
+        Q_EMIT model->dataChanged(model->index(first, 0), model->index(last, 0), maskToRoles(mask));
+    }
+}
+
 void UnityMenuModelPrivate::nameAppeared(GDBusConnection *connection, const gchar *name, const gchar *owner, gpointer user_data)
 {
     UnityMenuModelPrivate *priv = (UnityMenuModelPrivate *)user_data;
@@ -266,21 +464,75 @@ void UnityMenuModelPrivate::menuItemRemoved(gint position, gint n_items, gpointe
     QCoreApplication::sendEvent(priv->model, &ummrre);
 }
 
+/* Fills @roles with the roles that depend on the tracker item @property.
+ * Returns false if no role depends on it. An empty @roles means that all
+ * roles may have changed. */
+bool UnityMenuModelRow::rolesForProperty(const char *property, QVector<int> *roles)
+{
+    if (g_str_equal (property, "sensitive"))
+        *roles << SensitiveRole;
+    else if (g_str_equal (property, "toggled"))
+        *roles << IsToggledRole;
+    else if (g_str_equal (property, "role"))
+        *roles << IsCheckRole << IsRadioRole;
+    else if (g_str_equal (property, "action-state"))
+        *roles << ActionStateRole;
+    else if (g_str_equal (property, "label"))
+        *roles << LabelRole;
+    else if (g_str_equal (property, "icon"))
+        *roles << IconRole;
+    else if (g_str_equal (property, "accel"))
+        *roles << ShortcutRole;
+    else if (g_str_equal (property, "is-separator"))
+        *roles << IsSeparatorRole;
+    else if (g_str_equal (property, "has-submenu"))
+        *roles << HasSubmenuRole;
+    else if (g_str_equal (property, "action-name"))
+        *roles << ActionRole;
+    else if (g_str_equal (property, "submenu-shown") || g_str_equal (property, "visible"))
+        return false;
+
+    return true;
+}
+
+/* Drops the decoded attributes that depend on @roles */
+void UnityMenuModelRow::invalidate(const QVector<int> &roles)
+{
+    if (roles.isEmpty()) {
+        this->cached = 0;
+        return;
+    }
+
+    Q_FOREACH (int role, roles) {
+        switch (role) {
+            case LabelRole:
+                this->cached &= ~Label;
+                break;
+            case IconRole:
+                this->cached &= ~Icon;
+                break;
+            case TypeRole:
+                this->cached &= ~Type;
+                break;
+            case HasSubmenuRole:
+                this->cached &= ~HasSubmenu;
+                break;
+        }
+    }
+}
+
 void UnityMenuModelPrivate::menuItemChanged(GObject *object, GParamSpec *pspec, gpointer user_data)
 {
-    GSequenceIter *it = (GSequenceIter *) user_data;
-    GtkMenuTrackerItem *item;
-    GtkActionObservable *muxer;
-    UnityMenuModel *model;
-    gint position;
+    UnityMenuModelRow *row = (UnityMenuModelRow *) user_data;
+    QVector<int> roles;
+
+    if (!UnityMenuModelRow::rolesForProperty (g_param_spec_get_name (pspec), &roles))
+        return;
 
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
-    muxer = _gtk_menu_tracker_item_get_observable (item);
-    model = (UnityMenuModel *) g_object_get_qdata (G_OBJECT (item), unity_menu_model_quark ());
-    position = g_sequence_iter_get_position (it);
+    row->invalidate (roles);
 
-    UnityMenuModelDataChangeEvent ummdce(position);
-    QCoreApplication::sendEvent(model, &ummdce);
+    UnityMenuModelDataChangeEvent ummdce(row->position, roles);
+    QCoreApplication::sendEvent(row->priv->model, &ummdce);
 }
 
 UnityMenuModel::UnityMenuModel(QObject *parent):
@@ -358,13 +610,42 @@ void UnityMenuModel::setActionStateParser(ActionStateParser* actionStateParser)
 {
     if (priv->actionStateParser != actionStateParser) {
         priv->actionStateParser = actionStateParser;
+
+        /* states converted by the previous parser can't be reused */
+        Q_FOREACH (UnityMenuModelRow *row, priv->rows) {
+            if (row->state) {
+                g_variant_unref (row->state);
+                row->state = NULL;
+            }
+            row->stateValue = QVariant();
+        }
+
         Q_EMIT actionStateParserChanged(actionStateParser);
     }
 }
 
+/* Whether data changes of the menu items are collected and emitted once per
+ * event loop iteration (the default), or emitted as soon as they happen. */
+bool UnityMenuModel::coalesceDataChanges() const
+{
+    return priv->coalesceDataChanges;
+}
+
+void UnityMenuModel::setCoalesceDataChanges(bool coalesce)
+{
+    if (priv->coalesceDataChanges == coalesce)
+        return;
+
+    if (!coalesce)
+        priv->flushDataChanges();
+
+    priv->coalesceDataChanges = coalesce;
+    Q_EMIT coalesceDataChangesChanged(coalesce);
+}
+
 int UnityMenuModel::rowCount(const QModelIndex &parent) const
 {
-    return !parent.isValid() ? g_sequence_get_length (priv->items) : 0;
+    return !parent.isValid() ? priv->rows.size() : 0;
 }
 
 int UnityMenuModel::columnCount(const QModelIndex &parent) const
@@ -372,69 +653,39 @@ int UnityMenuModel::columnCount(const QModelIndex &parent) const
     return 1;
 }
 
-static QString iconUri(GIcon *icon)
+static const QVariant & rowType(UnityMenuModelRow *row)
 {
-    QString uri;
-
-    if (G_IS_THEMED_ICON (icon)) {
-        const gchar* const* iconNames = g_themed_icon_get_names (G_THEMED_ICON (icon));
-        guint index = 0;
-        while(iconNames[index] != NULL) {
-            if (QIcon::hasThemeIcon(iconNames[index])) {
-                uri = QString("image://theme/") + iconNames[index];
-                break;
-            }
-            index++;
-        }
-    }
-    else if (G_IS_FILE_ICON (icon)) {
-        GFile *file;
-
-        file = g_file_icon_get_file (G_FILE_ICON (icon));
-        if (file) {
-            gchar *fileuri;
-
-            fileuri = g_file_get_uri (file);
-            uri = QString(fileuri);
-
-            g_free (fileuri);
+    if (!(row->cached & UnityMenuModelRow::Type)) {
+        gchar *type;
+        if (gtk_menu_tracker_item_get_attribute (row->item, "x-canonical-type", "s", &type)) {
+            row->type = QVariant(type);
+            g_free (type);
         }
+        else
+            row->type = QVariant();
+        row->cached |= UnityMenuModelRow::Type;
     }
-    else if (G_IS_BYTES_ICON (icon)) {
-        gsize size;
-        gconstpointer data;
-        gchar *base64;
-
-        data = g_bytes_get_data (g_bytes_icon_get_bytes (G_BYTES_ICON (icon)), &size);
-        base64 = g_base64_encode ((const guchar *) data, size);
-
-        uri = QString("data://");
-        uri.append (base64);
-
-        g_free (base64);
-    }
-
-    return uri;
+    return row->type;
 }
 
 QVariant UnityMenuModel::data(const QModelIndex &index, int role) const
 {
-    GSequenceIter *it;
+    UnityMenuModelRow *row;
     GtkMenuTrackerItem *item;
 
-    it = g_sequence_get_iter_at_pos (priv->items, index.row());
-    if (g_sequence_iter_is_end (it)) {
-        return QVariant();
-    }
-
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
-    if (!item) {
+    row = priv->row (index.row());
+    if (!row || !row->item) {
         return QVariant();
     }
+    item = row->item;
 
     switch (role) {
         case LabelRole:
-            return gtk_menu_tracker_item_get_label (item);
+            if (!(row->cached & UnityMenuModelRow::Label)) {
+                row->label = QString::fromUtf8 (gtk_menu_tracker_item_get_label (item));
+                row->cached |= UnityMenuModelRow::Label;
+            }
+            return row->label;
 
         case SensitiveRole:
             return gtk_menu_tracker_item_get_sensitive (item) == TRUE ? true : false;
@@ -443,30 +694,29 @@ QVariant UnityMenuModel::data(const QModelIndex &index, int role) const
             return gtk_menu_tracker_item_get_is_separator (item) == TRUE ? true : false;
 
         case IconRole: {
-            GIcon *icon = gtk_menu_tracker_item_get_icon (item);
-            if (icon) {
-                QString uri = iconUri(icon);
-                g_object_unref (icon);
-                return uri;
+            // uris resolved for another icon theme are stale
+            quint32 generation = IconCache::generation();
+            if (!(row->cached & UnityMenuModelRow::Icon) || row->iconGeneration != generation) {
+                GIcon *icon = gtk_menu_tracker_item_get_icon (item);
+                IconCache::releaseIconUri(row->icon);
+                if (icon) {
+                    row->icon = IconCache::acquireIconUri(icon);
+                    g_object_unref (icon);
+                }
+                else
+                    row->icon = QString();
+                row->iconGeneration = generation;
+                row->cached |= UnityMenuModelRow::Icon;
             }
-            else
-                return QString();
+            return row->icon;
         }
 
-        case TypeRole: {
-            gchar *type;
-            if (gtk_menu_tracker_item_get_attribute (item, "x-canonical-type", "s", &type)) {
-                QVariant v(type);
-                g_free (type);
-                return v;
-            }
-            else
-                return QVariant();
-        }
+        case TypeRole:
+            return rowType (row);
 
         case ExtendedAttributesRole: {
-            QVariantMap *map = (QVariantMap *) g_object_get_qdata (G_OBJECT (item), unity_menu_item_extended_attributes_quark ());
-            return map ? *map : QVariant();
+            ExtendedAttributes *attrs = (ExtendedAttributes *) g_object_get_qdata (G_OBJECT (item), unity_menu_item_extended_attributes_quark ());
+            return attrs ? attrs->values : QVariant();
         }
 
         case ActionRole: {
@@ -477,7 +727,7 @@ QVariant UnityMenuModel::data(const QModelIndex &index, int role) const
         }
 
         case ActionStateRole:
-            return priv->itemState(item);
+            return priv->itemState(row);
 
         case IsCheckRole:
             return gtk_menu_tracker_item_get_role (item) == GTK_MENU_TRACKER_ITEM_ROLE_CHECK;
@@ -492,7 +742,11 @@ QVariant UnityMenuModel::data(const QModelIndex &index, int role) const
             return QKeySequence(gtk_menu_tracker_item_get_accel (item), QKeySequence::NativeText);
 
         case HasSubmenuRole:
-            return gtk_menu_tracker_item_get_has_submenu (item) != FALSE;
+            if (!(row->cached & UnityMenuModelRow::HasSubmenu)) {
+                row->hasSubmenu = gtk_menu_tracker_item_get_has_submenu (item) != FALSE;
+                row->cached |= UnityMenuModelRow::HasSubmenu;
+            }
+            return row->hasSubmenu;
 
         default:
             return QVariant();
@@ -530,18 +784,32 @@ QHash<int, QByteArray> UnityMenuModel::roleNames() const
     return names;
 }
 
+/* Every submenu opened with the same component shares one parser */
+ActionStateParser * UnityMenuModelPrivate::componentParser(QQmlComponent *component)
+{
+    QHash<QQmlComponent*, ComponentParser>::iterator it = this->componentParsers.find(component);
+    if (it != this->componentParsers.end() && it->component)
+        return it->parser;
+
+    ActionStateParser* parser = qobject_cast<ActionStateParser*>(component->create());
+    if (parser) {
+        ComponentParser entry;
+
+        parser->setParent(this->model);
+        entry.component = component;
+        entry.parser = parser;
+        this->componentParsers.insert(component, entry);
+    }
+
+    return parser;
+}
+
 QObject * UnityMenuModel::submenu(int position, QQmlComponent* actionStateParser)
 {
-    GSequenceIter *it;
     GtkMenuTrackerItem *item;
     UnityMenuModel *model;
 
-    it = g_sequence_get_iter_at_pos (priv->items, position);
-    if (g_sequence_iter_is_end (it)) {
-        return NULL;
-    }
-
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
+    item = priv->item (position);
     if (!item || !gtk_menu_tracker_item_get_has_submenu (item)) {
         return NULL;
     }
@@ -551,7 +819,7 @@ QObject * UnityMenuModel::submenu(int position, QQmlComponent* actionStateParser
         model = new UnityMenuModel(*priv, this);
 
         if (actionStateParser) {
-            ActionStateParser* parser = qobject_cast<ActionStateParser*>(actionStateParser->create());
+            ActionStateParser* parser = priv->componentParser(actionStateParser);
             if (parser) {
                 model->setActionStateParser(parser);
             }
@@ -569,58 +837,12 @@ QObject * UnityMenuModel::submenu(int position, QQmlComponent* actionStateParser
 
 static void freeExtendedAttrs(gpointer data)
 {
-    QVariantMap *extendedAttrs = (QVariantMap *) data;
+    ExtendedAttributes *extendedAttrs = (ExtendedAttributes *) data;
+    Q_FOREACH (const QString &uri, extendedAttrs->iconUris)
+        IconCache::releaseIconUri(uri);
     delete extendedAttrs;
 }
 
-static QVariant attributeToQVariant(GVariant *value, const QString &type)
-{
-    QVariant result;
-
-    if (type == "int") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
-            result =  QVariant(g_variant_get_int32(value));
-        }
-    }
-    else if (type == "int64") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64)) {
-            result =  QVariant((qlonglong)g_variant_get_int64(value));
-        }
-    }
-    else if (type == "bool") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
-            result = QVariant(g_variant_get_boolean(value));
-        }
-    }
-    else if (type == "string") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
-            result = QVariant(g_variant_get_string(value, NULL));
-        }
-    }
-    else if (type == "double") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_DOUBLE)) {
-            result = QVariant(g_variant_get_double(value));
-        }
-    }
-    else if (type == "variant") {
-        if (g_variant_is_of_type (value, G_VARIANT_TYPE_VARIANT)) {
-            result = Converter::toQVariant(value);
-        }
-    }
-    else if (type == "icon") {
-        GIcon *icon = g_icon_deserialize (value);
-        if (icon) {
-            result = iconUri(icon);
-            g_object_unref (icon);
-        }
-        else {
-            result = QVariant("");
-        }
-    }
-
-    return result;
-}
-
 /* convert 'some-key' to 'someKey' or 'SomeKey'. (from dconf-qt) */
 static QString qtify_name(const char *name)
 {
@@ -643,51 +865,230 @@ static QString qtify_name(const char *name)
     return result;
 }
 
-bool UnityMenuModel::loadExtendedAttributes(int position, const QVariantMap &schema)
+ExtendedAttributeSchema::ExtendedAttributeSchema(const QVariantMap &schema)
+    : source(schema),
+      sourceHash(hash(schema))
 {
-    GSequenceIter *it;
-    GtkMenuTrackerItem *item;
-    QVariantMap *extendedAttrs;
+    for (QVariantMap::const_iterator it = schema.constBegin(); it != schema.constEnd(); ++it) {
+        Attribute attribute;
+        QByteArray name = it.key().toUtf8();
+
+        attribute.name = name;
+        attribute.key = qtify_name (name.constData());
+        attribute.typeName = it.value().toString().toUtf8();
+
+        if (attribute.typeName == "int")
+            attribute.type = Int;
+        else if (attribute.typeName == "int64")
+            attribute.type = Int64;
+        else if (attribute.typeName == "bool")
+            attribute.type = Bool;
+        else if (attribute.typeName == "string")
+            attribute.type = String;
+        else if (attribute.typeName == "double")
+            attribute.type = Double;
+        else if (attribute.typeName == "variant")
+            attribute.type = Variant;
+        else if (attribute.typeName == "icon")
+            attribute.type = Icon;
+        else
+            attribute.type = Invalid;
 
-    it = g_sequence_get_iter_at_pos (priv->items, position);
-    if (g_sequence_iter_is_end (it)) {
-        return false;
+        attributes << attribute;
     }
+}
 
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
-    if (!item) {
-        return false;
+/* Icon uris are acquired for as long as the attributes are kept and appended
+ * to @iconUris */
+static QVariant attributeToQVariant(GVariant *value, ExtendedAttributeSchema::Type type, QStringList *iconUris)
+{
+    QVariant result;
+
+    switch (type) {
+        case ExtendedAttributeSchema::Int:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT32)) {
+                result =  QVariant(g_variant_get_int32(value));
+            }
+            break;
+
+        case ExtendedAttributeSchema::Int64:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_INT64)) {
+                result =  QVariant((qlonglong)g_variant_get_int64(value));
+            }
+            break;
+
+        case ExtendedAttributeSchema::Bool:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_BOOLEAN)) {
+                result = QVariant(g_variant_get_boolean(value));
+            }
+            break;
+
+        case ExtendedAttributeSchema::String:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_STRING)) {
+                result = QVariant(g_variant_get_string(value, NULL));
+            }
+            break;
+
+        case ExtendedAttributeSchema::Double:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_DOUBLE)) {
+                result = QVariant(g_variant_get_double(value));
+            }
+            break;
+
+        case ExtendedAttributeSchema::Variant:
+            if (g_variant_is_of_type (value, G_VARIANT_TYPE_VARIANT)) {
+                result = Converter::toQVariant(value);
+            }
+            break;
+
+        case ExtendedAttributeSchema::Icon: {
+            GIcon *icon = g_icon_deserialize (value);
+            if (icon) {
+                QString uri = IconCache::acquireIconUri(icon);
+                *iconUris << uri;
+                result = uri;
+                g_object_unref (icon);
+            }
+            else {
+                result = QVariant("");
+            }
+            break;
+        }
+
+        case ExtendedAttributeSchema::Invalid:
+            break;
     }
 
-    extendedAttrs = new QVariantMap;
+    return result;
+}
+
+/* Hashes the attribute names and type names of @schema, in key order */
+uint ExtendedAttributeSchema::hash(const QVariantMap &schema)
+{
+    uint h = 0;
 
     for (QVariantMap::const_iterator it = schema.constBegin(); it != schema.constEnd(); ++it) {
-        QString name = it.key();
-        QString type = it.value().toString();
+        h = 31 * h + qHash(it.key());
+        h = 31 * h + qHash(it.value().toString());
+    }
+
+    return h;
+}
+
+/* Returns the compiled version of @schema, compiling it on first use */
+const ExtendedAttributeSchema * UnityMenuModelPrivate::compiledSchema(const QVariantMap &schema)
+{
+    const uint h = ExtendedAttributeSchema::hash(schema);
+
+    QMultiHash<uint, ExtendedAttributeSchema*>::const_iterator it = this->schemas.constFind(h);
+    for (; it != this->schemas.constEnd() && it.key() == h; ++it) {
+        if (it.value()->source == schema) {
+            // schemas in use stay, the least recently used one goes first
+            this->schemaOrder.removeOne(it.value());
+            this->schemaOrder << it.value();
+            return it.value();
+        }
+    }
+
+    if (this->schemaOrder.size() >= MaxCachedSchemas) {
+        ExtendedAttributeSchema *oldest = this->schemaOrder.takeFirst();
+        this->schemas.remove(oldest->sourceHash, oldest);
+        delete oldest;
+    }
+
+    ExtendedAttributeSchema *compiled = new ExtendedAttributeSchema(schema);
+    this->schemas.insert(h, compiled);
+    this->schemaOrder << compiled;
+    return compiled;
+}
+
+static ExtendedAttributes * loadAttributes(GtkMenuTrackerItem *item, const ExtendedAttributeSchema *schema)
+{
+    ExtendedAttributes *extendedAttrs = new ExtendedAttributes;
 
-        GVariant *value = gtk_menu_tracker_item_get_attribute_value (item, name.toUtf8(), NULL);
+    Q_FOREACH (const ExtendedAttributeSchema::Attribute &attribute, schema->attributes) {
+        GVariant *value = gtk_menu_tracker_item_get_attribute_value (item, attribute.name.constData(), NULL);
         if (value == NULL) {
-            qCWarning(unitymenumodel, "loadExtendedAttributes: menu item does not contain '%s'", it.key().toUtf8().constData());
+            qCWarning(unitymenumodel, "loadExtendedAttributes: menu item does not contain '%s'", attribute.name.constData());
             continue;
         }
 
-        const QVariant &qvalue = attributeToQVariant(value, type);
+        const QVariant &qvalue = attributeToQVariant(value, attribute.type, &extendedAttrs->iconUris);
         if (qvalue.isValid())
-            extendedAttrs->insert(qtify_name (name.toUtf8()), qvalue);
+            extendedAttrs->values.insert(attribute.key, qvalue);
         else
             qCWarning(unitymenumodel, "loadExtendedAttributes: key '%s' is of type '%s' (expected '%s')",
-                     name.toUtf8().constData(), g_variant_get_type_string(value), type.constData());
+                     attribute.name.constData(), g_variant_get_type_string(value), attribute.typeName.constData());
 
         g_variant_unref (value);
     }
 
+    return extendedAttrs;
+}
+
+static void setExtendedAttributes(GtkMenuTrackerItem *item, ExtendedAttributes *extendedAttrs)
+{
     g_object_set_qdata_full (G_OBJECT (item), unity_menu_item_extended_attributes_quark (),
                              extendedAttrs, freeExtendedAttrs);
+}
+
+/* Loads the extended attributes of @row if a schema was registered for its
+ * type. Returns whether attributes were loaded. */
+bool UnityMenuModelPrivate::loadTypeAttributes(UnityMenuModelRow *row)
+{
+    if (this->typeSchemas.isEmpty())
+        return false;
+
+    const QVariant &type = rowType(row);
+    if (!type.isValid())
+        return false;
+
+    ExtendedAttributeSchema *schema = this->typeSchemas.value(type.toString());
+    if (!schema)
+        return false;
+
+    setExtendedAttributes(row->item, loadAttributes(row->item, schema));
+    return true;
+}
+
+bool UnityMenuModel::loadExtendedAttributes(int position, const QVariantMap &schema)
+{
+    GtkMenuTrackerItem *item;
+
+    item = priv->item (position);
+    if (!item) {
+        return false;
+    }
+
+    setExtendedAttributes(item, loadAttributes(item, priv->compiledSchema(schema)));
 
     Q_EMIT dataChanged(index(position, 0), index(position, 0), QVector<int>() << ExtendedAttributesRole);
     return true;
 }
 
+/* Registers @schema as the extended attributes of rows whose x-canonical-type
+ * is @type. Those attributes are loaded when the rows are inserted, so they
+ * are part of the row's data from the start and calling
+ * loadExtendedAttributes is not needed. Submenus created afterwards inherit
+ * the registered schemas. */
+void UnityMenuModel::registerExtendedAttributes(const QString &type, const QVariantMap &schema)
+{
+    delete priv->typeSchemas.take(type);
+    if (schema.isEmpty())
+        return;
+
+    priv->typeSchemas.insert(type, new ExtendedAttributeSchema(schema));
+
+    // load them for the rows which are already there
+    for (int i = 0; i < priv->rows.size(); ++i) {
+        UnityMenuModelRow *row = priv->rows.at(i);
+        if (rowType(row) == type && priv->loadTypeAttributes(row))
+            priv->addDataChange(i, QVector<int>() << ExtendedAttributesRole);
+    }
+    if (!priv->coalesceDataChanges)
+        priv->flushDataChanges();
+}
+
 QVariant UnityMenuModel::get(int row, const QByteArray &role)
 {
     if (priv->roles.isEmpty()) {
@@ -701,17 +1102,11 @@ QVariant UnityMenuModel::get(int row, const QByteArray &role)
 
 void UnityMenuModel::activate(int index, const QVariant& parameter)
 {
-    GSequenceIter *it;
     GtkMenuTrackerItem *item;
     GVariant *value;
     const GVariantType *parameter_type;
 
-    it = g_sequence_get_iter_at_pos (priv->items, index);
-    if (g_sequence_iter_is_end (it)) {
-        return;
-    }
-
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
+    item = priv->item (index);
     if (!item) {
         return;
     }
@@ -732,12 +1127,7 @@ void UnityMenuModel::activate(int index, const QVariant& parameter)
 
 void UnityMenuModel::aboutToShow(int index)
 {
-    GSequenceIter *it = g_sequence_get_iter_at_pos (priv->items, index);
-    if (g_sequence_iter_is_end (it)) {
-        return;
-    }
-
-    auto item = static_cast<GtkMenuTrackerItem*>(g_sequence_get(it));
+    auto item = priv->item (index);
     if (!item) {
         return;
     }
@@ -783,17 +1173,11 @@ void UnityMenuModel::changeStateByVariantString(int index, const QString& parame
 
 void UnityMenuModel::changeState(int index, const QVariant& parameter)
 {
-    GSequenceIter *it;
     GtkMenuTrackerItem* item;
     GVariant* data;
     GVariant* current_state;
 
-    it = g_sequence_get_iter_at_pos (priv->items, index);
-    if (g_sequence_iter_is_end (it)) {
-        return;
-    }
-
-    item = (GtkMenuTrackerItem *) g_sequence_get (it);
+    item = priv->item (index);
     if (!item) {
         return;
     }
@@ -819,15 +1203,11 @@ bool UnityMenuModel::event(QEvent* e)
     if (e->type() == UnityMenuModelClearEvent::eventType) {
         UnityMenuModelClearEvent *emmce = static_cast<UnityMenuModelClearEvent*>(e);
 
-        GSequenceIter *begin;
-        GSequenceIter *end;
-
         if (emmce->reset)
             beginResetModel();
 
-        begin = g_sequence_get_begin_iter (priv->items);
-        end = g_sequence_get_end_iter (priv->items);
-        g_sequence_remove_range (begin, end);
+        priv->dirtyRows.clear();
+        priv->removeRows(0, priv->rows.size());
 
         if (emmce->reset)
             endResetModel();
@@ -836,37 +1216,36 @@ bool UnityMenuModel::event(QEvent* e)
     } else if (e->type() == UnityMenuModelAddRowEvent::eventType) {
         UnityMenuModelAddRowEvent *ummrce = static_cast<UnityMenuModelAddRowEvent*>(e);
 
-        GSequenceIter *it;
-        it = g_sequence_get_iter_at_pos (priv->items, ummrce->position);
+        // pending changes refer to the current row positions
+        priv->flushDataChanges();
 
         beginInsertRows(QModelIndex(), ummrce->position, ummrce->position + ummrce->items->len - 1);
-
-        for (gint i = ummrce->items->len - 1; i >= 0; --i) {
-            GtkMenuTrackerItem *item = (GtkMenuTrackerItem*)g_ptr_array_index(ummrce->items, i);
-            it = g_sequence_insert_before (it, g_object_ref (item));
-            g_object_set_qdata (G_OBJECT (item), unity_menu_model_quark (), this);
-            g_signal_connect (item, "notify", G_CALLBACK (UnityMenuModelPrivate::menuItemChanged), it);
-        }
-
+        priv->insertRows(ummrce->position, ummrce->items);
+        for (guint i = 0; i < ummrce->items->len; ++i)
+            priv->loadTypeAttributes(priv->rows.at(ummrce->position + i));
         endInsertRows();
         return true;
     } else if (e->type() == UnityMenuModelRemoveRowEvent::eventType) {
         UnityMenuModelRemoveRowEvent *ummrre = static_cast<UnityMenuModelRemoveRowEvent*>(e);
 
+        priv->flushDataChanges();
+
         beginRemoveRows(QModelIndex(), ummrre->position, ummrre->position + ummrre->nItems - 1);
-        for (int i = 0; i < ummrre->nItems; ++i) {
-            GSequenceIter *it = g_sequence_get_iter_at_pos (priv->items, ummrre->position);
-            if (!g_sequence_iter_is_end (it)) {
-                g_sequence_remove (it);
-            }
-        }
+        priv->removeRows(ummrre->position, ummrre->nItems);
         endRemoveRows();
 
         return true;
     } else if (e->type() == UnityMenuModelDataChangeEvent::eventType) {
         UnityMenuModelDataChangeEvent *ummdce = static_cast<UnityMenuModelDataChangeEvent*>(e);
 
-        Q_EMIT dataChanged(index(ummdce->position, 0), index(ummdce->position, 0));
+        if (priv->coalesceDataChanges)
+            priv->addDataChange(ummdce->position, ummdce->roles);
+        else
+            Q_EMIT dataChanged(index(ummdce->position, 0), index(ummdce->position, 0), ummdce->roles);
+        return true;
+    } else if (e->type() == UnityMenuModelFlushEvent::eventType) {
+        priv->flushPending = false;
+        priv->flushDataChanges();
         return true;
     }
     return QAbstractListModel::event(e);
@@ -919,24 +1298,17 @@ void UnityMenuModel::unregisterAction(UnityMenuAction* action)
  */
 char * UnityMenuModelPrivate::fullActionName(UnityMenuAction *action)
 {
-    GSequenceIter *iter;
+    GtkMenuTrackerItem *item;
     QByteArray bytes;
     const gchar *name;
-    gchar *full_name = NULL;
 
     bytes = action->name().toUtf8();
     name = bytes.constData();
 
-    iter = g_sequence_get_iter_at_pos (this->items, action->index());
-    if (!g_sequence_iter_is_end (iter)) {
-        GtkMenuTrackerItem *item;
+    item = this->item (action->index());
+    if (item) {
         const gchar *action_namespace;
 
-        item = (GtkMenuTrackerItem *) g_sequence_get (iter);
-        if (!item) {
-            return g_strdup (name);
-        }
-
         action_namespace = gtk_menu_tracker_item_get_action_namespace (item);
         if (action_namespace != NULL)
           return g_strjoin (".", action_namespace, name, NULL);
@@ -963,7 +1335,7 @@ void UnityMenuModelPrivate::updateRegisteredAction(UnityMenuAction *action)
     if (g_action_group_query_action (G_ACTION_GROUP (this->muxer), action_name,
                                      &enabled, NULL, NULL, NULL, &state))
     {
-        UnityMenuActionAddEvent umaae(enabled, Converter::toQVariant(state));
+        UnityMenuActionAddEvent umaae(enabled, LazyVariant(state));
         QCoreApplication::sendEvent(action, &umaae);
 
         if (state) {
@@ -1019,7 +1391,7 @@ void UnityMenuModelPrivate::registeredActionAdded(GtkSimpleActionObserver    *ob
     action = (UnityMenuAction *) g_object_get_qdata (G_OBJECT (observer_item), unity_menu_action_quark ());
 
     if (action) {
-        UnityMenuActionAddEvent umaae(enabled, Converter::toQVariant(state));
+        UnityMenuActionAddEvent umaae(enabled, LazyVariant(state));
         QCoreApplication::sendEvent(action, &umaae);
     }
 }
@@ -1041,7 +1413,7 @@ void UnityMenuModelPrivate::registeredActionStateChanged(GtkSimpleActionObserver
     action = (UnityMenuAction *) g_object_get_qdata (G_OBJECT (observer_item), unity_menu_action_quark ());
 
     if (action) {
-        UnityMenuActionStateChangeEvent umasce(Converter::toQVariant(state));
+        UnityMenuActionStateChangeEvent umasce(LazyVariant(state));
         QCoreApplication::sendEvent(action, &umasce);
     }
 }
@@ -32,6 +32,7 @@ class UnityMenuModel: public QAbstractListModel
     Q_PROPERTY(QVariantMap actions READ actions WRITE setActions NOTIFY actionsChanged)
     Q_PROPERTY(QByteArray menuObjectPath READ menuObjectPath WRITE setMenuObjectPath NOTIFY menuObjectPathChanged)
     Q_PROPERTY(ActionStateParser* actionStateParser READ actionStateParser WRITE setActionStateParser NOTIFY actionStateParserChanged)
+    Q_PROPERTY(bool coalesceDataChanges READ coalesceDataChanges WRITE setCoalesceDataChanges NOTIFY coalesceDataChangesChanged)
 
 public:
     UnityMenuModel(QObject *parent = NULL);
@@ -51,6 +52,9 @@ public:
     ActionStateParser* actionStateParser() const;
     void setActionStateParser(ActionStateParser* actionStateParser);
 
+    bool coalesceDataChanges() const;
+    void setCoalesceDataChanges(bool coalesce);
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     int columnCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
@@ -60,6 +64,7 @@ public:
 
     Q_INVOKABLE QObject * submenu(int position, QQmlComponent* actionStateParser = NULL);
     Q_INVOKABLE bool loadExtendedAttributes(int position, const QVariantMap &schema);
+    Q_INVOKABLE void registerExtendedAttributes(const QString &type, const QVariantMap &schema);
     Q_INVOKABLE QVariant get(int row, const QByteArray &role);
 
     Q_INVOKABLE void activate(int index, const QVariant& parameter = QVariant());
@@ -77,6 +82,7 @@ Q_SIGNALS:
     void actionsChanged(const QByteArray &path);
     void menuObjectPathChanged(const QByteArray &path);
     void actionStateParserChanged(ActionStateParser* parser);
+    void coalesceDataChangesChanged(bool coalesce);
 
 protected Q_SLOTS:
     void onRegisteredActionNameChanged(const QString& name);
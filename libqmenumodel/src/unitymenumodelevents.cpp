@@ -29,6 +29,7 @@ const QEvent::Type UnityMenuModelClearEvent::eventType = static_cast<QEvent::Typ
 const QEvent::Type UnityMenuModelAddRowEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type UnityMenuModelRemoveRowEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 const QEvent::Type UnityMenuModelDataChangeEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+const QEvent::Type UnityMenuModelFlushEvent::eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
 
 UnityMenuModelClearEvent::UnityMenuModelClearEvent(bool _reset)
     : QEvent(UnityMenuModelClearEvent::eventType),
@@ -61,7 +62,12 @@ UnityMenuModelRemoveRowEvent::UnityMenuModelRemoveRowEvent(int _position, int _n
       position(_position), nItems(_nItems)
 {}
 
-UnityMenuModelDataChangeEvent::UnityMenuModelDataChangeEvent(int _position)
+UnityMenuModelDataChangeEvent::UnityMenuModelDataChangeEvent(int _position, const QVector<int> &_roles)
     : QEvent(UnityMenuModelDataChangeEvent::eventType),
-      position(_position)
+      position(_position),
+      roles(_roles)
+{}
+
+UnityMenuModelFlushEvent::UnityMenuModelFlushEvent()
+    : QEvent(UnityMenuModelFlushEvent::eventType)
 {}
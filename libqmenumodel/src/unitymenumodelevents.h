@@ -21,6 +21,7 @@
 #define UNITYMENUMODELEVENTS_H
 
 #include <QEvent>
+#include <QVector>
 #include <glib.h>
 
 typedef struct _GtkMenuTrackerItem GtkMenuTrackerItem;
@@ -63,9 +64,18 @@ class UnityMenuModelDataChangeEvent : public QEvent
 {
 public:
     static const QEvent::Type eventType;
-    UnityMenuModelDataChangeEvent(int position);
+    UnityMenuModelDataChangeEvent(int position, const QVector<int> &roles = QVector<int>());
 
     int position;
+    QVector<int> roles;
+};
+
+/* Event for emitting the data changes collected by a unitymenumodel */
+class UnityMenuModelFlushEvent : public QEvent
+{
+public:
+    static const QEvent::Type eventType;
+    UnityMenuModelFlushEvent();
 };
 
 #endif //UNITYMENUMODELEVENTS_H
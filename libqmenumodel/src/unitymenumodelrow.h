@@ -0,0 +1,81 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UNITYMENUMODELROW_H
+#define UNITYMENUMODELROW_H
+
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <glib.h>
+
+typedef struct _GtkMenuTrackerItem GtkMenuTrackerItem;
+typedef struct _GVariant GVariant;
+class UnityMenuModelPrivate;
+
+enum MenuRoles {
+    LabelRole  = Qt::DisplayRole + 1,
+    SensitiveRole,
+    IsSeparatorRole,
+    IconRole,
+    TypeRole,
+    ExtendedAttributesRole,
+    ActionRole,
+    ActionStateRole,
+    IsCheckRole,
+    IsRadioRole,
+    IsToggledRole,
+    ShortcutRole,
+    HasSubmenuRole
+};
+
+/* A row of the model. Rows are heap allocated so that their address can be
+ * handed to the item's notify handler, which then finds its position without
+ * a search.
+ *
+ * The attributes read most often are decoded on first access and kept until
+ * the item notifies a change of the corresponding property. The icon is also
+ * decoded again after the icon theme changed. The action state is kept
+ * together with its conversion, which is reused while the state is equal and
+ * lets a changed dictionary state share its unchanged entries. */
+struct UnityMenuModelRow
+{
+    enum CachedField {
+        Label = 1 << 0,
+        Icon = 1 << 1,
+        Type = 1 << 2,
+        HasSubmenu = 1 << 3
+    };
+
+    static bool rolesForProperty(const char *property, QVector<int> *roles);
+    void invalidate(const QVector<int> &roles);
+
+    GtkMenuTrackerItem *item;
+    UnityMenuModelPrivate *priv;
+    gulong notifyId;
+    int position;
+
+    quint8 cached;
+    bool hasSubmenu;
+    QString label;
+    QString icon;
+    quint32 iconGeneration;     // IconCache::generation() when icon was resolved
+    QVariant type;
+    GVariant *state;
+    QVariant stateValue;
+};
+
+#endif // UNITYMENUMODELROW_H
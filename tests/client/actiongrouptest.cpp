@@ -19,6 +19,7 @@
 
 #include "qdbusmenumodel.h"
 #include "qdbusactiongroup.h"
+#include "qdbusactionlistmodel.h"
 #include "dbusmenuscript.h"
 #include "qstateaction.h"
 
@@ -211,6 +212,83 @@ private Q_SLOTS:
         // Action appear
         QVERIFY(act->isValid());
     }
+
+    /*
+     * Test if the actions model follows the actions of the group
+     */
+    void testActionsModel()
+    {
+        QDBusActionListModel *model = m_actionGroup.actionsModel();
+        QVERIFY(model);
+
+        // Append 2 menus
+        m_script.walk(2);
+        QVERIFY(model->contains("Menu1Act"));
+        QCOMPARE(model->rowCount(), m_actionGroup.actions().count());
+
+        QSignalSpy removed(model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+
+        // Remove 1 menu
+        m_script.walk(1);
+        QVERIFY(!model->contains("Menu1Act"));
+        QVERIFY(!m_actionGroup.actions().contains("Menu1Act"));
+        QCOMPARE(removed.count(), 1);
+    }
+
+    /*
+     * Test if removing several actions removes each range of adjacent rows
+     * at once, from the last one
+     */
+    void testActionsModelRemoveRanges()
+    {
+        QDBusActionListModel model;
+        model.appendActions(QStringList() << "a" << "b" << "c" << "d" << "e" << "f" << "g");
+
+        QSignalSpy removed(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QSignalSpy count(&model, SIGNAL(countChanged(int)));
+
+        model.removeActions(QStringList() << "b" << "f" << "unknown" << "c" << "g" << "b");
+        QCOMPARE(model.actions(), QStringList() << "a" << "d" << "e");
+        QVERIFY(!model.contains("b"));
+        QVERIFY(model.contains("d"));
+
+        QCOMPARE(removed.count(), 2);
+        QCOMPARE(removed.at(0).at(1).toInt(), 5);
+        QCOMPARE(removed.at(0).at(2).toInt(), 6);
+        QCOMPARE(removed.at(1).at(1).toInt(), 1);
+        QCOMPARE(removed.at(1).at(2).toInt(), 2);
+        QCOMPARE(count.count(), 1);
+
+        // nothing to remove
+        model.removeActions(QStringList() << "b" << "unknown");
+        QCOMPARE(removed.count(), 2);
+        QCOMPARE(count.count(), 1);
+
+        model.removeActions(QStringList() << "a" << "d" << "e");
+        QCOMPARE(model.count(), 0);
+        QCOMPARE(removed.count(), 3);
+    }
+
+    /*
+     * Benchmark connecting to a group with many actions, which are delivered
+     * with a single actionsChanged
+     */
+    void benchmarkConnect()
+    {
+        m_script.run();
+        const int count = m_actionGroup.actions().count();
+        QVERIFY(count > 100);
+
+        QBENCHMARK {
+            m_actionGroup.stop();
+
+            QSignalSpy changed(&m_actionGroup, SIGNAL(actionsChanged()));
+            m_actionGroup.start();
+            QVERIFY(changed.count() > 0 || changed.wait());
+            QCOMPARE(m_actionGroup.actions().count(), count);
+            QCOMPARE(changed.count(), 1);
+        }
+    }
 };
 
 QTEST_MAIN(ActionGroupTest);
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "actionstateparser.h"
+
+extern "C" {
+#include <glib.h>
+}
+
+#include <QObject>
+#include <QtTest>
+
+/* Overrides toQVariant without declaring Q_OBJECT, so its meta object is the
+ * one of ActionStateParser */
+class PlainSubclassParser : public ActionStateParser
+{
+public:
+    virtual QVariant toQVariant(GVariant *) const
+    {
+        return QVariant("subclass");
+    }
+};
+
+static QVariant typeConverter(GVariant *)
+{
+    return QVariant("type");
+}
+
+static QVariant actionConverter(GVariant *)
+{
+    return QVariant("action");
+}
+
+class ActionStateParserTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QVariant parse(ActionStateParser *parser, const char *actionName, const char *state)
+    {
+        GVariant *gstate = g_variant_ref_sink(g_variant_new_parsed(state));
+        QVariant result = parser->parseState(actionName, gstate);
+        g_variant_unref(gstate);
+        return result;
+    }
+
+private Q_SLOTS:
+    /*
+     * Test if only the shared parser takes the native path
+     */
+    void testNative()
+    {
+        QVERIFY(ActionStateParser::sharedParser()->isNative());
+        QCOMPARE(ActionStateParser::sharedParser(), ActionStateParser::sharedParser());
+
+        ActionStateParser plain;
+        QVERIFY(!plain.isNative());
+        QCOMPARE(parse(&plain, "plain", "uint16 3"), QVariant::fromValue<quint16>(3));
+
+        PlainSubclassParser subclass;
+        QVERIFY(!subclass.isNative());
+        QCOMPARE(parse(&subclass, "subclass", "uint16 3"), QVariant("subclass"));
+    }
+
+    /*
+     * Test if converters registered for the type of a state are used
+     */
+    void testTypeConverter()
+    {
+        ActionStateParser *parser = ActionStateParser::sharedParser();
+        QCOMPARE(parse(parser, "type", "(1, 2)"), QVariant(QVariantList() << 1 << 2));
+
+        ActionStateParser::registerTypeConverter("(ii)", typeConverter);
+        QCOMPARE(parse(parser, "type", "(1, 2)"), QVariant("type"));
+        QCOMPARE(parse(parser, "type", "(1, 'two')"), QVariant(QVariantList() << 1 << "two"));
+
+        // plain parsers convert through toQVariant, which knows the type converters too
+        ActionStateParser plain;
+        QCOMPARE(parse(&plain, "type", "(1, 2)"), QVariant("type"));
+    }
+
+    /*
+     * Test if converters registered for an action pattern come before the
+     * ones for the type of its state
+     */
+    void testActionConverterPrecedence()
+    {
+        ActionStateParser *parser = ActionStateParser::sharedParser();
+
+        ActionStateParser::registerTypeConverter("(uu)", typeConverter);
+        ActionStateParser::registerActionConverter("volume.*", actionConverter);
+
+        QCOMPARE(parse(parser, "volume.level", "(uint32 1, uint32 2)"), QVariant("action"));
+        QCOMPARE(parse(parser, "volume", "(uint32 1, uint32 2)"), QVariant("type"));
+        QCOMPARE(parse(parser, "brightness", "(uint32 1, uint32 2)"), QVariant("type"));
+
+        // whatever the type of the state
+        QCOMPARE(parse(parser, "volume.muted", "true"), QVariant("action"));
+        QCOMPARE(parse(parser, "brightness", "true"), QVariant(true));
+
+        // the action name is not known to toQVariant
+        ActionStateParser plain;
+        QCOMPARE(parse(&plain, "volume.muted", "true"), QVariant(true));
+    }
+
+    /*
+     * Test the typed readers, which fall back to a default for other types
+     */
+    void testStateValue()
+    {
+        GVariant *state = g_variant_ref_sink(g_variant_new_parsed("true"));
+        QCOMPARE(ActionStateParser::stateValue<bool>(state), true);
+        QCOMPARE(ActionStateParser::stateValue<qint32>(state), 0);
+        QCOMPARE(ActionStateParser::convertState<bool>(state), QVariant(true));
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("int32 -7"));
+        QCOMPARE(ActionStateParser::stateValue<qint32>(state), -7);
+        QCOMPARE(ActionStateParser::stateValue<qint64>(state), qint64(0));
+        QCOMPARE(ActionStateParser::stateValue<bool>(state), false);
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("uint32 7"));
+        QCOMPARE(ActionStateParser::stateValue<quint32>(state), quint32(7));
+        QCOMPARE(ActionStateParser::stateValue<qint32>(state), 0);
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("int64 -8589934592"));
+        QCOMPARE(ActionStateParser::stateValue<qint64>(state), Q_INT64_C(-8589934592));
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("uint64 8589934592"));
+        QCOMPARE(ActionStateParser::stateValue<quint64>(state), Q_UINT64_C(8589934592));
+        QCOMPARE(ActionStateParser::stateValue<qint64>(state), qint64(0));
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("0.25"));
+        QCOMPARE(ActionStateParser::stateValue<double>(state), 0.25);
+        QCOMPARE(ActionStateParser::stateValue<QString>(state), QString());
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("'dança'"));
+        QCOMPARE(ActionStateParser::stateValue<QString>(state), QString::fromUtf8("dança"));
+        QCOMPARE(ActionStateParser::stateValue<double>(state), 0.0);
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("['a', 'b']"));
+        QCOMPARE(ActionStateParser::stateValue<QStringList>(state), QStringList() << "a" << "b");
+        QVERIFY(ActionStateParser::stateValue<QVariantMap>(state).isEmpty());
+        g_variant_unref(state);
+
+        state = g_variant_ref_sink(g_variant_new_parsed("{'level': <3>}"));
+        QCOMPARE(ActionStateParser::stateValue<QVariantMap>(state).value("level"), QVariant(3));
+        QVERIFY(ActionStateParser::stateValue<QStringList>(state).isEmpty());
+        g_variant_unref(state);
+    }
+};
+
+QTEST_MAIN(ActionStateParserTest)
+
+#include "actionstateparsertest.moc"
@@ -23,6 +23,7 @@ extern "C" {
 }
 
 #include "converter.h"
+#include "lazyvariant.h"
 
 #include <QObject>
 #include <QtTest>
@@ -56,6 +57,14 @@ private:
 };
 Q_DECLARE_METATYPE(QGVariant);
 
+static int s_warnings = 0;
+
+static void countWarnings(QtMsgType type, const QMessageLogContext &, const QString &)
+{
+    if (type == QtWarningMsg)
+        s_warnings++;
+}
+
 class ConverterTest : public QObject
 {
     Q_OBJECT
@@ -105,6 +114,13 @@ private:
         return result;
     }
 
+    template<typename T>
+    static QGVariant fixedArray(const GVariantType *type, gsize size = 3)
+    {
+        const T values[] = {T(1), T(2), T(3)};
+        return QGVariant(g_variant_new_fixed_array(type, values, size, sizeof(T)));
+    }
+
 private Q_SLOTS:
 
     /*
@@ -192,6 +208,143 @@ private Q_SLOTS:
         g_variant_unref(gTuple);
     }
 
+    void testFixedArrayConversion()
+    {
+        QVector<double> doubles;
+        doubles << 1.5 << 2.5 << 3.5;
+
+        GVariant *gArray = Converter::toGVariant(QVariant::fromValue(doubles));
+        QVERIFY(gArray != NULL);
+        QCOMPARE(QString(g_variant_get_type_string(gArray)), QString("ad"));
+        QCOMPARE(Converter::toFixedArray(gArray).value<QVector<double> >(), doubles);
+
+        // toQVariant takes the same path for ad, the result still reads as a list
+        QVariant qArray = Converter::toQVariant(gArray);
+        QCOMPARE(qArray.userType(), qMetaTypeId<QVector<double> >());
+        QCOMPARE(qArray.value<QVector<double> >(), doubles);
+        QVariantList list = qArray.value<QVariantList>();
+        QCOMPARE(list.size(), 3);
+        QCOMPARE(list.at(1).toDouble(), 2.5);
+
+        GVariant *gBack = Converter::toGVariant(qArray);
+        QVERIFY(g_variant_equal(gArray, gBack));
+        g_variant_unref(gBack);
+
+        // and so does a state with the array
+        LazyVariant state(gArray);
+        QCOMPARE(state.toVariant().value<QVector<double> >(), doubles);
+        QCOMPARE(state.toList().size(), 3);
+
+        gBack = Converter::toGVariantWithSchema(qArray, "ad");
+        QVERIFY(g_variant_equal(gArray, gBack));
+        g_variant_unref(gBack);
+        g_variant_unref(gArray);
+
+        const qint64 longs[] = {1, -2, 3};
+        gArray = g_variant_ref_sink(g_variant_new_fixed_array(G_VARIANT_TYPE_INT64, longs, 3, sizeof(qint64)));
+        QCOMPARE(Converter::toFixedArray(gArray).value<QVector<qint64> >(), QVector<qint64>() << 1 << -2 << 3);
+        QCOMPARE(Converter::toQVariant(gArray).toList(), QVariantList() << qint64(1) << qint64(-2) << qint64(3));
+        g_variant_unref(gArray);
+
+        const qint32 ints[] = {4, -5, 6};
+        gArray = g_variant_ref_sink(g_variant_new_fixed_array(G_VARIANT_TYPE_INT32, ints, 3, sizeof(qint32)));
+        qArray = Converter::toQVariant(gArray);
+        QCOMPARE(qArray.userType(), qMetaTypeId<QVector<int> >());
+        QCOMPARE(qArray.value<QVector<int> >(), QVector<int>() << 4 << -5 << 6);
+        gBack = Converter::toGVariant(qArray);
+        QVERIFY(g_variant_equal(gArray, gBack));
+        g_variant_unref(gBack);
+        g_variant_unref(gArray);
+
+        const guchar bytes[] = {'a', 0, 'b'};
+        gArray = g_variant_ref_sink(g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, bytes, 3, sizeof(guchar)));
+        QCOMPARE(Converter::toFixedArray(gArray).toByteArray(), QByteArray("a\0b", 3));
+        g_variant_unref(gArray);
+
+        gArray = g_variant_ref_sink(g_variant_new_strv(NULL, 0));
+        QVERIFY(!Converter::toFixedArray(gArray).isValid());
+        g_variant_unref(gArray);
+    }
+
+    void testFixedArrayRoundTrip_data()
+    {
+        QTest::addColumn<QGVariant>("value");
+
+        const guchar bytes[] = {'a', 'b', '\0'};
+        QTest::newRow("Byte") << QGVariant(g_variant_new_fixed_array(G_VARIANT_TYPE_BYTE, bytes, 3, sizeof(guchar)));
+        QTest::newRow("Int16") << fixedArray<qint16>(G_VARIANT_TYPE_INT16);
+        QTest::newRow("UInt16") << fixedArray<quint16>(G_VARIANT_TYPE_UINT16);
+        QTest::newRow("Int32") << fixedArray<qint32>(G_VARIANT_TYPE_INT32);
+        QTest::newRow("UInt32") << fixedArray<quint32>(G_VARIANT_TYPE_UINT32);
+        QTest::newRow("Int64") << fixedArray<qint64>(G_VARIANT_TYPE_INT64);
+        QTest::newRow("UInt64") << fixedArray<quint64>(G_VARIANT_TYPE_UINT64);
+        QTest::newRow("Double") << fixedArray<double>(G_VARIANT_TYPE_DOUBLE);
+        QTest::newRow("Empty") << fixedArray<double>(G_VARIANT_TYPE_DOUBLE, 0);
+    }
+
+    /*
+     * Test if toGVariant turns the result of toFixedArray back into the same array
+     */
+    void testFixedArrayRoundTrip()
+    {
+        QFETCH(QGVariant, value);
+
+        QVariant qv = Converter::toFixedArray(value);
+        QVERIFY(qv.isValid());
+
+        GVariant *gv = Converter::toGVariant(qv);
+        QVERIFY(gv != NULL);
+        QCOMPARE(QString(g_variant_get_type_string(gv)), QString(g_variant_get_type_string(value)));
+        QVERIFY(g_variant_equal(value, gv));
+        g_variant_unref(gv);
+    }
+
+    void testLazyVariant()
+    {
+        GVariant *gState = g_variant_ref_sink(g_variant_new_parsed("{'volume': <0.5>, 'muted': <false>, 'devices': <['a', 'b']>}"));
+        LazyVariant state(gState);
+
+        QCOMPARE(state.count(), 3);
+        QVERIFY(state.contains("volume"));
+        QVERIFY(!state.contains("missing"));
+        QCOMPARE(state.value("volume"), QVariant(0.5));
+        QCOMPARE(state.value("devices").toStringList(), QStringList() << "a" << "b");
+        QCOMPARE(state.keys().toSet(), QSet<QString>() << "volume" << "muted" << "devices");
+
+        QCOMPARE(state.toMap(), Converter::toQVariant(gState).toMap());
+        QCOMPARE(QVariant::fromValue(state).toMap(), state.toMap());
+        QCOMPARE(state, LazyVariant(gState));
+        g_variant_unref(gState);
+
+        gState = g_variant_ref_sink(g_variant_new_parsed("[<1>, <'two'>]"));
+        state = LazyVariant(gState);
+        QCOMPARE(state.at(0), QVariant(1));
+        QCOMPARE(state.at(1), QVariant("two"));
+        QVERIFY(!state.at(2).isValid());
+        g_variant_unref(gState);
+
+        QVERIFY(LazyVariant().isNull());
+        QVERIFY(!LazyVariant().toVariant().isValid());
+    }
+
+    void testVardictDiff()
+    {
+        GVariant *previous = g_variant_ref_sink(g_variant_new_parsed("{'volume': <0.5>, 'muted': <false>, 'device': <'a'>}"));
+        GVariant *current = g_variant_ref_sink(g_variant_new_parsed("{'volume': <0.7>, 'muted': <false>, 'title': <'b'>}"));
+
+        QStringList changed = Converter::changedKeys(previous, current);
+        QCOMPARE(changed.toSet(), QSet<QString>() << "volume" << "device" << "title");
+        QVERIFY(Converter::changedKeys(previous, previous).isEmpty());
+
+        QVariant previousResult = Converter::toQVariant(previous);
+        QVariant result = Converter::toQVariantWithPrevious(current, previous, previousResult);
+        QCOMPARE(result, Converter::toQVariant(current));
+        QCOMPARE(Converter::toQVariantWithPrevious(previous, previous, previousResult), previousResult);
+
+        g_variant_unref(previous);
+        g_variant_unref(current);
+    }
+
     void testConvertToGVariantWithSchema_data()
     {
         QTest::addColumn<QVariant>("value");
@@ -285,11 +438,23 @@ private Q_SLOTS:
         QTest::newRow("Map") << QGVariant(g_variant_builder_end(builder)) << (unsigned) QVariant::Map;
         g_variant_builder_unref(builder);
 
-        builder = g_variant_builder_new(G_VARIANT_TYPE("ai"));
-        g_variant_builder_add(builder, "i", g_variant_new_int32(53));
-        QTest::newRow("List") << QGVariant(g_variant_new("ai", builder)) << (unsigned) QVariant::List;
+        const gchar *strings[] = {"foo", "bar", NULL};
+        builder = g_variant_builder_new(G_VARIANT_TYPE_VARDICT);
+        g_variant_builder_add(builder, "{sv}", "strings", g_variant_new_strv(strings, -1));
+        g_variant_builder_add(builder, "{sv}", "tuple", g_variant_new("(sd)", "foo", 53.3));
+        QTest::newRow("Nested Map") << QGVariant(g_variant_builder_end(builder)) << (unsigned) QVariant::Map;
+        g_variant_builder_unref(builder);
+
+        builder = g_variant_builder_new(G_VARIANT_TYPE("ax"));
+        g_variant_builder_add(builder, "x", (gint64) 53);
+        QTest::newRow("List") << QGVariant(g_variant_new("ax", builder)) << (unsigned) QVariant::List;
         g_variant_builder_unref(builder);
 
+        QTest::newRow("Int16 Array") << fixedArray<qint16>(G_VARIANT_TYPE_INT16) << (unsigned) QVariant::List;
+        QTest::newRow("UInt16 Array") << fixedArray<quint16>(G_VARIANT_TYPE_UINT16) << (unsigned) QVariant::List;
+        QTest::newRow("UInt32 Array") << fixedArray<quint32>(G_VARIANT_TYPE_UINT32) << (unsigned) QVariant::List;
+        QTest::newRow("UInt64 Array") << fixedArray<quint64>(G_VARIANT_TYPE_UINT64) << (unsigned) QVariant::List;
+
         QTest::newRow("Tuple") << QGVariant(g_variant_new("(i)", 53)) << (unsigned) QVariant::List;
 
         const gchar *byteArray[] = {"42", "53", NULL};
@@ -378,6 +543,30 @@ private Q_SLOTS:
         QCOMPARE(Converter::toQVariantFromVariantString(value).type(), (QVariant::Type) expectedType);
     }
 
+    void testVariantStringCache()
+    {
+        Converter::clearVariantStringCache();
+
+        QCOMPARE(Converter::toQVariantFromVariantString("int32 65"), QVariant(65));
+        QCOMPARE(Converter::toQVariantFromVariantString("int32 65"), QVariant(65));
+        QCOMPARE(Converter::variantStringCacheMisses(), (quint64) 1);
+        QCOMPARE(Converter::variantStringCacheHits(), (quint64) 1);
+
+        // failures are kept as well, and only warned about when parsed
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression("Impossible to parse.*"));
+        QVERIFY(!Converter::toQVariantFromVariantString("[65").isValid());
+
+        s_warnings = 0;
+        QtMessageHandler handler = qInstallMessageHandler(countWarnings);
+        QVERIFY(!Converter::toQVariantFromVariantString("[65").isValid());
+        QVERIFY(!Converter::toQVariantFromVariantString("[65").isValid());
+        qInstallMessageHandler(handler);
+        QCOMPARE(s_warnings, 0);
+
+        QCOMPARE(Converter::variantStringCacheMisses(), (quint64) 2);
+        QCOMPARE(Converter::variantStringCacheHits(), (quint64) 3);
+    }
+
 };
 
 QTEST_MAIN(ConverterTest)
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "iconcache.h"
+#include "bytesiconprovider.h"
+
+extern "C" {
+#include <gio/gio.h>
+}
+
+#include <QBuffer>
+#include <QIcon>
+#include <QImage>
+#include <QObject>
+#include <QtTest>
+
+class IconCacheTest : public QObject
+{
+    Q_OBJECT
+private:
+    QString m_themeName;
+
+    static QString fileIconUri(const QString &path)
+    {
+        GFile *file = g_file_new_for_path(path.toUtf8().constData());
+        GIcon *icon = g_file_icon_new(file);
+
+        QString uri = IconCache::iconUri(icon);
+
+        g_object_unref(icon);
+        g_object_unref(file);
+        return uri;
+    }
+
+    static GIcon *bytesIcon(char fill, int size)
+    {
+        gpointer data = g_malloc(size);
+        memset(data, fill, size);
+        GBytes *bytes = g_bytes_new_take(data, size);
+
+        GIcon *icon = g_bytes_icon_new(bytes);
+        g_bytes_unref(bytes);
+        return icon;
+    }
+
+    static QString unpinnedUri(char fill, int size)
+    {
+        GIcon *icon = bytesIcon(fill, size);
+        QString uri = IconCache::iconUri(icon);
+        g_object_unref(icon);
+        return uri;
+    }
+
+    static QString pinnedUri(char fill, int size)
+    {
+        GIcon *icon = bytesIcon(fill, size);
+        QString uri = IconCache::acquireIconUri(icon);
+        g_object_unref(icon);
+        return uri;
+    }
+
+private Q_SLOTS:
+    void init()
+    {
+        m_themeName = QIcon::themeName();
+        IconCache::clear();
+    }
+
+    void cleanup()
+    {
+        QIcon::setThemeName(m_themeName);
+    }
+
+    /*
+     * Test if a resolved uri is served from the cache
+     */
+    void testHits()
+    {
+        QCOMPARE(fileIconUri("/tmp/icon.png"), QString("file:///tmp/icon.png"));
+        QCOMPARE(IconCache::hits(), quint64(0));
+        QCOMPARE(IconCache::misses(), quint64(1));
+
+        QCOMPARE(fileIconUri("/tmp/icon.png"), QString("file:///tmp/icon.png"));
+        QCOMPARE(IconCache::hits(), quint64(1));
+        QCOMPARE(IconCache::misses(), quint64(1));
+
+        fileIconUri("/tmp/other.png");
+        QCOMPARE(IconCache::hits(), quint64(1));
+        QCOMPARE(IconCache::misses(), quint64(2));
+    }
+
+    /*
+     * Test if the cache starts over when the icon theme changes
+     */
+    void testThemeChange()
+    {
+        fileIconUri("/tmp/icon.png");
+        fileIconUri("/tmp/icon.png");
+        QCOMPARE(IconCache::hits(), quint64(1));
+        quint32 generation = IconCache::generation();
+
+        QIcon::setThemeName(m_themeName + "-changed");
+        QVERIFY(IconCache::generation() != generation);
+
+        fileIconUri("/tmp/icon.png");
+        QCOMPARE(IconCache::hits(), quint64(1));
+        QCOMPARE(IconCache::misses(), quint64(2));
+
+        fileIconUri("/tmp/icon.png");
+        QCOMPARE(IconCache::hits(), quint64(2));
+    }
+
+    /*
+     * Test if the cache starts over once it holds 1024 uris
+     */
+    void testSizeCap()
+    {
+        fileIconUri("/tmp/icon.png");
+        for (int i = 1; i < 1024; ++i)
+            fileIconUri(QString("/tmp/icon%1.png").arg(i));
+        QCOMPARE(IconCache::misses(), quint64(1024));
+
+        // still cached with 1024 uris
+        fileIconUri("/tmp/icon.png");
+        QCOMPARE(IconCache::hits(), quint64(1));
+
+        // one more drops everything
+        fileIconUri("/tmp/icon1024.png");
+        QCOMPARE(IconCache::misses(), quint64(1025));
+
+        fileIconUri("/tmp/icon.png");
+        QCOMPARE(IconCache::hits(), quint64(1));
+        QCOMPARE(IconCache::misses(), quint64(1026));
+
+        fileIconUri("/tmp/icon1024.png");
+        QCOMPARE(IconCache::hits(), quint64(2));
+    }
+
+    /*
+     * Test if image data held by a row survives payloads pushing everything
+     * else out of the store
+     */
+    void testBytesEviction()
+    {
+        const int large = 12 * 1024 * 1024;
+
+        QString pinned = pinnedUri('p', 1024);
+        QString unpinned = unpinnedUri('u', 1024);
+        QVERIFY(pinned.startsWith("image://qmenumodel-bytes/"));
+        QVERIFY(BytesIconProvider::contains(pinned));
+        QVERIFY(BytesIconProvider::contains(unpinned));
+
+        unpinnedUri('a', large);
+        unpinnedUri('b', large);
+        unpinnedUri('c', large);
+
+        QVERIFY(BytesIconProvider::contains(pinned));
+        QVERIFY(!BytesIconProvider::contains(unpinned));
+
+        // held twice, kept until released twice
+        QCOMPARE(pinnedUri('p', 1024), pinned);
+        IconCache::releaseIconUri(pinned);
+        unpinnedUri('d', large);
+        unpinnedUri('e', large);
+        unpinnedUri('f', large);
+        QVERIFY(BytesIconProvider::contains(pinned));
+
+        // released data is evicted like any other
+        IconCache::releaseIconUri(pinned);
+        QVERIFY(BytesIconProvider::contains(pinned));
+        unpinnedUri('g', large);
+        unpinnedUri('h', large);
+        unpinnedUri('i', large);
+        QVERIFY(!BytesIconProvider::contains(pinned));
+
+        // uris of other icons are ignored
+        IconCache::releaseIconUri("file:///tmp/icon.png");
+        IconCache::releaseIconUri(QString());
+    }
+
+    /*
+     * Test if image data larger than the whole store is served while held
+     */
+    void testBytesOversize()
+    {
+        const int oversize = 33 * 1024 * 1024;
+
+        // nothing holds it, so it is never stored
+        QString unpinned = unpinnedUri('o', oversize);
+        QVERIFY(!BytesIconProvider::contains(unpinned));
+
+        QString pinned = pinnedUri('o', oversize);
+        QCOMPARE(pinned, unpinned);
+        QVERIFY(BytesIconProvider::contains(pinned));
+
+        IconCache::releaseIconUri(pinned);
+        QVERIFY(!BytesIconProvider::contains(pinned));
+    }
+
+    /*
+     * Test if the image behind a held uri is served
+     */
+    void testBytesImage()
+    {
+        QImage image(8, 4, QImage::Format_ARGB32);
+        image.fill(Qt::blue);
+        QByteArray png;
+        QBuffer buffer(&png);
+        buffer.open(QIODevice::WriteOnly);
+        QVERIFY(image.save(&buffer, "PNG"));
+
+        GBytes *bytes = g_bytes_new(png.constData(), png.size());
+        GIcon *icon = g_bytes_icon_new(bytes);
+        QString uri = IconCache::acquireIconUri(icon);
+        g_object_unref(icon);
+        g_bytes_unref(bytes);
+
+        BytesIconProvider provider;
+        const QString prefix = QString("image://%1/").arg(BytesIconProvider::providerId);
+        QSize size;
+        QImage served = provider.requestImage(uri.mid(prefix.length()), &size, QSize());
+        QCOMPARE(size, QSize(8, 4));
+        QCOMPARE(served.pixel(0, 0), image.pixel(0, 0));
+
+        IconCache::releaseIconUri(uri);
+    }
+};
+
+QTEST_MAIN(IconCacheTest)
+
+#include "iconcachetest.moc"
@@ -20,6 +20,7 @@
 #include "qmenumodel.h"
 
 #include <QObject>
+#include <QSignalSpy>
 #include <QtTest>
 #include <QDebug>
 
@@ -28,6 +29,17 @@ extern "C" {
 }
 
 
+static bool s_holdItemsChanged = false;
+
+/* Keeps items-changed from reaching the model while the menu is edited, so
+ * that a test can announce several edits at once */
+static void holdItemsChanged(GMenuModel *model, gint, gint, gint, gpointer)
+{
+    if (s_holdItemsChanged) {
+        g_signal_stop_emission_by_name(model, "items-changed");
+    }
+}
+
 class MenuModelTestClass : public QMenuModel
 {
     Q_OBJECT
@@ -37,6 +49,16 @@ public:
     {
     }
 
+    MenuModelTestClass(GMenu *menu)
+        : QMenuModel(G_MENU_MODEL(menu)), m_step(0)
+    {
+    }
+
+    GMenu *menu() const
+    {
+        return G_MENU(menuModel());
+    }
+
     void loadModel()
     {
         GMenu *root = G_MENU(menuModel());
@@ -183,6 +205,18 @@ public Q_SLOTS:
         }
     }
 
+    void recordLabels()
+    {
+        QStringList labels;
+        for (int i = 0; i < rowCount(); i++) {
+            labels << data(index(i), QMenuModel::Label).toString();
+        }
+        m_labels << labels;
+    }
+
+public:
+    QList<QStringList> m_labels;
+
 private:
     int m_step;
 };
@@ -219,6 +253,138 @@ private Q_SLOTS:
                          &model, SLOT(checkModelStateAfterRemove(QModelIndex,int,int)));
         model.clear();
     }
+
+    /*
+     * Test if items inserted in and removed from a section are announced as
+     * such, below the row of the section
+     */
+    void testSignalNestedRows()
+    {
+        MenuModelTestClass model;
+        GMenu *root = model.menu();
+        GMenu *section = g_menu_new();
+        g_menu_append(section, "a", NULL);
+        g_menu_append(root, "item", NULL);
+        g_menu_append_section(root, "section", G_MENU_MODEL(section));
+
+        QModelIndex parent = model.index(1);
+        QCOMPARE(model.rowCount(parent), 1);
+
+        QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QSignalSpy removed(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+
+        g_menu_append(section, "b", NULL);
+        g_menu_append(section, "c", NULL);
+        QCOMPARE(inserted.count(), 2);
+        QCOMPARE(removed.count(), 0);
+        QCOMPARE(inserted.at(0).at(0).value<QModelIndex>(), parent);
+        QCOMPARE(inserted.at(0).at(1).toInt(), 1);
+        QCOMPARE(inserted.at(0).at(2).toInt(), 1);
+        QCOMPARE(inserted.at(1).at(1).toInt(), 2);
+        QCOMPARE(model.rowCount(parent), 3);
+
+        g_menu_remove(section, 0);
+        QCOMPARE(inserted.count(), 2);
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(removed.at(0).at(0).value<QModelIndex>(), parent);
+        QCOMPARE(removed.at(0).at(1).toInt(), 0);
+        QCOMPARE(removed.at(0).at(2).toInt(), 0);
+
+        QCOMPARE(model.rowCount(parent), 2);
+        QCOMPARE(model.data(model.index(0, 0, parent), QMenuModel::Label).toString(), QString("b"));
+        QCOMPARE(model.data(model.index(1, 0, parent), QMenuModel::Label).toString(), QString("c"));
+
+        // the top level is left alone
+        QCOMPARE(model.rowCount(), 2);
+        g_object_unref(section);
+    }
+
+    /*
+     * Test if rows read while an items-changed that removes and adds items
+     * is announced never show the labels of the removed items
+     */
+    void testSignalMixedChange()
+    {
+        GMenu *menu = g_menu_new();
+        g_signal_connect(menu, "items-changed", G_CALLBACK(holdItemsChanged), NULL);
+        g_menu_append(menu, "a", NULL);
+        g_menu_append(menu, "b", NULL);
+        g_menu_append(menu, "c", NULL);
+
+        MenuModelTestClass model(menu);
+        model.recordLabels();
+        QCOMPARE(model.m_labels.takeFirst(), QStringList() << "a" << "b" << "c");
+
+        QObject::connect(&model, SIGNAL(rowsAboutToBeRemoved(QModelIndex,int,int)),
+                         &model, SLOT(recordLabels()));
+        QObject::connect(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                         &model, SLOT(recordLabels()));
+        QObject::connect(&model, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
+                         &model, SLOT(recordLabels()));
+        QObject::connect(&model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                         &model, SLOT(recordLabels()));
+
+        // [a, b, c] -> [a, x, y, z] in one items-changed
+        s_holdItemsChanged = true;
+        g_menu_remove(menu, 2);
+        g_menu_remove(menu, 1);
+        g_menu_append(menu, "x", NULL);
+        g_menu_append(menu, "y", NULL);
+        g_menu_append(menu, "z", NULL);
+        s_holdItemsChanged = false;
+        g_menu_model_items_changed(G_MENU_MODEL(menu), 1, 2, 3);
+
+        QCOMPARE(model.m_labels.size(), 4);
+        QCOMPARE(model.m_labels.at(0), QStringList() << "a" << "" << "");
+        QCOMPARE(model.m_labels.at(1), QStringList() << "a");
+        QCOMPARE(model.m_labels.at(2), QStringList() << "a");
+        QCOMPARE(model.m_labels.at(3), QStringList() << "a" << "x" << "y" << "z");
+
+        g_object_unref(menu);
+    }
+
+    /*
+     * Test if an item replaced in place is read again instead of served from
+     * the attributes cached for the item it replaces
+     */
+    void testSignalReplaceItem()
+    {
+        GMenu *menu = g_menu_new();
+        g_signal_connect(menu, "items-changed", G_CALLBACK(holdItemsChanged), NULL);
+        g_menu_append(menu, "a", NULL);
+        GMenuItem *item = g_menu_item_new("b", NULL);
+        g_menu_item_set_attribute(item, "x-state", "s", "old");
+        g_menu_append_item(menu, item);
+        g_object_unref(item);
+        g_menu_append(menu, "c", NULL);
+
+        MenuModelTestClass model(menu);
+        QModelIndex row1 = model.index(1);
+        QCOMPARE(model.data(row1, QMenuModel::Label).toString(), QString("b"));
+        QCOMPARE(model.data(row1, QMenuModel::Extra).toMap().value("state").toString(), QString("old"));
+
+        QSignalSpy removed(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QSignalSpy inserted(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+
+        s_holdItemsChanged = true;
+        g_menu_remove(menu, 1);
+        item = g_menu_item_new("b2", NULL);
+        g_menu_item_set_attribute(item, "x-state", "s", "new");
+        g_menu_insert_item(menu, 1, item);
+        g_object_unref(item);
+        s_holdItemsChanged = false;
+        g_menu_model_items_changed(G_MENU_MODEL(menu), 1, 1, 1);
+
+        QCOMPARE(removed.count(), 1);
+        QCOMPARE(inserted.count(), 1);
+        QCOMPARE(model.rowCount(), 3);
+        QCOMPARE(model.data(model.index(0), QMenuModel::Label).toString(), QString("a"));
+        QCOMPARE(model.data(row1, QMenuModel::Label).toString(), QString("b2"));
+        QCOMPARE(model.data(row1, QMenuModel::Extra).toMap().value("state").toString(), QString("new"));
+        QCOMPARE(model.data(model.index(2), QMenuModel::Label).toString(), QString("c"));
+
+        g_object_unref(menu);
+    }
 };
 
 QTEST_MAIN(ModelSignalsTest)
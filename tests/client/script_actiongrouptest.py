@@ -23,6 +23,10 @@ al.appendItem("Menu0", "Menu0Act", actionStateType=variant_type_from_string('s')
 al.appendItem("Menu1", "Menu1Act", actionStateType=variant_type_from_string('s'))
 al.removeItem("1", "Menu1Act")
 
+# a large group for the connection benchmark
+for i in range(100):
+    al.appendItem("Bench%d" % i, "Bench%dAct" % i)
+
 t = Script.create(al)
 t.run()
 
@@ -19,6 +19,7 @@
  */
 
 #include "qmenumodel.h"
+#include "menunode.h"
 
 extern "C" {
 #include <gio/gio.h>
@@ -53,6 +54,11 @@ public:
         m_menus << menu << menu3 << menu5;
     }
 
+    GMenu *menu(int i) const
+    {
+        return m_menus.at(i);
+    }
+
 private:
     QList<GMenu*> m_menus;
 };
@@ -105,6 +111,130 @@ private Q_SLOTS:
         QCOMPARE(menu.data(parent_6, QMenuModel::Depth).toInt(), 1);
         QCOMPARE(menu.data(parent_6, QMenuModel::Label).toString(), QString("menu5"));
     }
+
+    /*
+     * Test if changes two levels down are announced below the index of the
+     * section they happen in, also after the rows before it changed
+     */
+    void testNestedChangeParent()
+    {
+        TestModel menu;
+        QSignalSpy inserted(&menu, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QSignalSpy removed(&menu, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+
+        // menu5 is the second row of menu3, the fourth row of the root
+        g_menu_append(menu.menu(2), "menu9", NULL);
+        QCOMPARE(inserted.count(), 1);
+        QModelIndex parent = inserted.first().at(0).value<QModelIndex>();
+        QCOMPARE(parent, menu.index(1, 0, menu.index(3)));
+        QCOMPARE(parent.parent(), menu.index(3));
+        QCOMPARE(menu.data(parent, QMenuModel::Label).toString(), QString("menu5"));
+        QCOMPARE(inserted.first().at(1).toInt(), 2);
+        QCOMPARE(menu.rowCount(parent), 3);
+
+        // shift menu5 down within menu3 and menu3 within the root
+        g_menu_insert(menu.menu(1), 0, "menu10", NULL);
+        g_menu_insert(menu.menu(0), 0, "menu11", NULL);
+        inserted.clear();
+
+        g_menu_remove(menu.menu(2), 0);
+        QCOMPARE(removed.count(), 1);
+        parent = removed.first().at(0).value<QModelIndex>();
+        QCOMPARE(parent.row(), 2);
+        QCOMPARE(parent.parent().row(), 4);
+        QVERIFY(!parent.parent().parent().isValid());
+        QCOMPARE(parent, menu.index(2, 0, menu.index(4)));
+        QCOMPARE(menu.data(parent, QMenuModel::Label).toString(), QString("menu5"));
+        QCOMPARE(menu.data(parent, QMenuModel::Depth).toInt(), 1);
+        QCOMPARE(removed.first().at(1).toInt(), 0);
+        QCOMPARE(removed.first().at(2).toInt(), 0);
+
+        QModelIndex row7 = menu.index(0, 0, parent);
+        QCOMPARE(menu.data(row7, QMenuModel::Label).toString(), QString("menu7"));
+        QCOMPARE(menu.data(row7, QMenuModel::Depth).toInt(), 2);
+    }
+
+    /*
+     * Test if a menu linked from two sections is found at its position in
+     * each of them
+     */
+    void testSharedLink()
+    {
+        GMenu *shared = g_menu_new();
+        g_menu_append(shared, "shared0", NULL);
+
+        GMenu *first = g_menu_new();
+        g_menu_append(first, "first0", NULL);
+        g_menu_append_section(first, "shared", G_MENU_MODEL(shared));
+
+        GMenu *second = g_menu_new();
+        g_menu_append_section(second, "shared", G_MENU_MODEL(shared));
+
+        GMenu *menu = g_menu_new();
+        g_menu_append_section(menu, "first", G_MENU_MODEL(first));
+        g_menu_append_section(menu, "second", G_MENU_MODEL(second));
+
+        MenuNode *root = new MenuNode("", G_MENU_MODEL(menu), 0, 0, 0);
+        QCOMPARE(root->child(0)->childPosition(G_MENU_MODEL(shared)), 1);
+        QCOMPARE(root->child(1)->childPosition(G_MENU_MODEL(shared)), 0);
+        QCOMPARE(root->child(0)->child(1)->parent(), root->child(0));
+        QCOMPARE(root->child(1)->child(0)->parent(), root->child(1));
+        delete root;
+
+        g_object_unref(menu);
+        g_object_unref(second);
+        g_object_unref(first);
+        g_object_unref(shared);
+    }
+
+    /*
+     * Test if sections of a lazy model are only read when a view fetches
+     * them, and are announced with a row insertion
+     */
+    void testLazyPopulate()
+    {
+        TestModel menu;
+        QVERIFY(!menu.canFetchMore(menu.index(3)));
+
+        QSignalSpy reset(&menu, SIGNAL(modelReset()));
+        menu.setLazyLoading(true);
+        QCOMPARE(reset.count(), 1);
+        QCOMPARE(menu.rowCount(), 4);
+
+        QModelIndex row0 = menu.index(0);
+        QVERIFY(!menu.hasChildren(row0));
+        QVERIFY(!menu.canFetchMore(row0));
+
+        QModelIndex row3 = menu.index(3);
+        QCOMPARE(menu.data(row3, QMenuModel::Label).toString(), QString("menu3"));
+        QVERIFY(menu.hasChildren(row3));
+        QVERIFY(menu.canFetchMore(row3));
+
+        // asking for the rows or an index below it reads nothing
+        QCOMPARE(menu.rowCount(row3), 0);
+        menu.index(0, 0, row3);
+        QVERIFY(menu.canFetchMore(row3));
+
+        // a view expanding a section is told about its rows
+        QSignalSpy inserted(&menu, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        menu.fetchMore(row3);
+        QVERIFY(!menu.canFetchMore(row3));
+        QCOMPARE(inserted.count(), 1);
+        QCOMPARE(inserted.first().at(0).value<QModelIndex>(), row3);
+        QCOMPARE(inserted.first().at(1).toInt(), 0);
+        QCOMPARE(inserted.first().at(2).toInt(), 2);
+        QCOMPARE(menu.rowCount(row3), 3);
+
+        // and the sections below it wait for their own fetch
+        QModelIndex row5 = menu.index(1, 0, row3);
+        QVERIFY(menu.hasChildren(row5));
+        QVERIFY(menu.canFetchMore(row5));
+        QCOMPARE(menu.rowCount(row5), 0);
+        menu.fetchMore(row5);
+        QCOMPARE(menu.rowCount(row5), 2);
+        QModelIndex row6 = menu.index(0, 0, row5);
+        QCOMPARE(menu.data(row6, QMenuModel::Label).toString(), QString("menu6"));
+    }
 };
 
 QTEST_MAIN(TreeTest)
@@ -19,14 +19,27 @@
 
 #include "unitymenumodel.h"
 #include "unitymenuaction.h"
+#include "unitymenuactionevents.h"
+
+extern "C" {
+#include <glib.h>
+}
 
 #include <QObject>
+#include <QQmlComponent>
+#include <QQmlContext>
+#include <QQmlEngine>
 #include <QtTest>
 
 class UnityMenuActionTest : public QObject
 {
     Q_OBJECT
 private:
+    static void changeState(UnityMenuAction *action, const char *state)
+    {
+        UnityMenuActionStateChangeEvent umasce(LazyVariant(g_variant_new_parsed(state)));
+        QCoreApplication::sendEvent(action, &umasce);
+    }
 
 private Q_SLOTS:
 
@@ -55,6 +68,73 @@ private Q_SLOTS:
         delete action;
         delete model;
     }
+
+    /*
+     * Test if a binding on lazyState is updated without converting the state
+     */
+    void testLazyStateBinding()
+    {
+        UnityMenuAction action;
+        QQmlEngine engine;
+        engine.rootContext()->setContextProperty("action", &action);
+
+        QQmlComponent component(&engine);
+        component.setData("import QtQml 2.0\n"
+                          "QtObject { property int count: action.lazyState.count }", QUrl());
+        QObject *object = component.create();
+        QVERIFY(object != NULL);
+
+        changeState(&action, "{'volume': <0.5>, 'muted': <false>}");
+        QCOMPARE(object->property("count").toInt(), 2);
+        QVERIFY(!action.lazyState().isConverted());
+
+        changeState(&action, "{'volume': <0.5>, 'muted': <false>, 'level': <3>}");
+        QCOMPARE(object->property("count").toInt(), 3);
+        QVERIFY(!action.lazyState().isConverted());
+
+        // listening for the converted state still converts it
+        QSignalSpy spy(&action, SIGNAL(stateChanged(QVariant)));
+        changeState(&action, "{'volume': <0.7>}");
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(action.lazyState().isConverted());
+        QCOMPARE(spy.first().at(0).toMap().value("volume").toDouble(), 0.7);
+
+        delete object;
+    }
+
+    /*
+     * Test if the changed keys are those of the last update, and if binding
+     * them leaves the state unconverted
+     */
+    void testChangedStateKeys()
+    {
+        UnityMenuAction action;
+        QQmlEngine engine;
+        engine.rootContext()->setContextProperty("action", &action);
+
+        QQmlComponent component(&engine);
+        component.setData("import QtQml 2.0\n"
+                          "QtObject { property var keys: action.changedStateKeys }", QUrl());
+        QObject *object = component.create();
+        QVERIFY(object != NULL);
+
+        // nothing to compare the first state with
+        changeState(&action, "{'volume': <0.5>, 'muted': <false>}");
+        QVERIFY(object->property("keys").toStringList().isEmpty());
+
+        changeState(&action, "{'volume': <0.5>, 'muted': <true>}");
+        QCOMPARE(object->property("keys").toStringList(), QStringList() << "muted");
+
+        changeState(&action, "{'muted': <true>}");
+        QCOMPARE(action.changedStateKeys(), QStringList() << "volume");
+        QCOMPARE(object->property("keys").toStringList(), QStringList() << "volume");
+        QVERIFY(!action.lazyState().isConverted());
+
+        changeState(&action, "true");
+        QVERIFY(action.changedStateKeys().isEmpty());
+
+        delete object;
+    }
 };
 
 QTEST_MAIN(UnityMenuActionTest)
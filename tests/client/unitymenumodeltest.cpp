@@ -0,0 +1,360 @@
+/*
+ * Copyright 2013 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "unitymenumodel.h"
+#include "unitymenumodelevents.h"
+#include "unitymenumodelrow.h"
+
+extern "C" {
+#include <gio/gio.h>
+#include "gtk/gtkactionmuxer.h"
+#include "gtk/gtkmenutracker.h"
+}
+
+#include <QIcon>
+#include <QImage>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QtTest>
+
+/* Feeds a UnityMenuModel from a local menu, the same way the model is fed
+ * from its own tracker for a menu on the bus */
+class LocalMenu
+{
+public:
+    LocalMenu(UnityMenuModel *model)
+        : menu(g_menu_new()),
+          actions(g_simple_action_group_new()),
+          muxer(gtk_action_muxer_new()),
+          tracker(NULL),
+          model(model)
+    {
+        gtk_action_muxer_insert(muxer, "test", G_ACTION_GROUP(actions));
+    }
+
+    ~LocalMenu()
+    {
+        if (tracker)
+            gtk_menu_tracker_free(tracker);
+        g_object_unref(muxer);
+        g_object_unref(actions);
+        g_object_unref(menu);
+    }
+
+    GSimpleAction *addCheck(const gchar *label, const gchar *name)
+    {
+        GSimpleAction *action = g_simple_action_new_stateful(name, NULL, g_variant_new_boolean(FALSE));
+        g_action_map_add_action(G_ACTION_MAP(actions), G_ACTION(action));
+        g_object_unref(action);
+
+        gchar *detailed = g_strconcat("test.", name, NULL);
+        g_menu_append(menu, label, detailed);
+        g_free(detailed);
+
+        return action;
+    }
+
+    void addIcon(const gchar *label, const gchar *iconName)
+    {
+        GMenuItem *item = g_menu_item_new(label, NULL);
+        GIcon *icon = g_themed_icon_new(iconName);
+
+        g_menu_item_set_icon(item, icon);
+        g_menu_append_item(menu, item);
+
+        g_object_unref(icon);
+        g_object_unref(item);
+    }
+
+    void addItem(GMenuItem *item)
+    {
+        g_menu_append_item(menu, item);
+        g_object_unref(item);
+    }
+
+    void track()
+    {
+        tracker = gtk_menu_tracker_new(GTK_ACTION_OBSERVABLE(muxer), G_MENU_MODEL(menu), TRUE, NULL,
+                                       itemsInserted, itemsRemoved, model);
+    }
+
+    GMenu *menu;
+    GSimpleActionGroup *actions;
+    GtkActionMuxer *muxer;
+    GtkMenuTracker *tracker;
+    UnityMenuModel *model;
+
+private:
+    static void itemsInserted(GPtrArray *items, gint position, gpointer user_data)
+    {
+        UnityMenuModelAddRowEvent ummare(items, position);
+        QCoreApplication::sendEvent((QObject *) user_data, &ummare);
+    }
+
+    static void itemsRemoved(gint position, gint n_items, gpointer user_data)
+    {
+        UnityMenuModelRemoveRowEvent ummrre(position, n_items);
+        QCoreApplication::sendEvent((QObject *) user_data, &ummrre);
+    }
+};
+
+class UnityMenuModelTest : public QObject
+{
+    Q_OBJECT
+private:
+    UnityMenuModel *m_model;
+    LocalMenu *m_menu;
+
+    int role(const QByteArray &name) const
+    {
+        return m_model->roleNames().key(name, -1);
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        qRegisterMetaType<QVector<int> >();
+    }
+
+    void init()
+    {
+        m_model = new UnityMenuModel;
+        m_menu = new LocalMenu(m_model);
+    }
+
+    void cleanup()
+    {
+        delete m_menu;
+        delete m_model;
+    }
+
+    /*
+     * Test if changes of several rows in one event loop iteration are
+     * emitted as one dataChanged with the roles of all of them
+     */
+    void testCoalescedDataChanges()
+    {
+        GSimpleAction *check = m_menu->addCheck("Check", "check");
+        GSimpleAction *toggle = m_menu->addCheck("Toggle", "toggle");
+        m_menu->track();
+        QCOMPARE(m_model->rowCount(), 2);
+        QVERIFY(m_model->coalesceDataChanges());
+
+        QSignalSpy changed(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+        g_simple_action_set_enabled(check, FALSE);
+        g_simple_action_set_state(check, g_variant_new_boolean(TRUE));
+        g_simple_action_set_state(toggle, g_variant_new_boolean(TRUE));
+        QCOMPARE(changed.count(), 0);
+
+        QTRY_COMPARE(changed.count(), 1);
+        QList<QVariant> args = changed.takeFirst();
+        QCOMPARE(args.at(0).value<QModelIndex>().row(), 0);
+        QCOMPARE(args.at(1).value<QModelIndex>().row(), 1);
+        QCOMPARE(args.at(2).value<QVector<int> >(), QVector<int>() << role("sensitive")
+                                                                   << role("actionState")
+                                                                   << role("isToggled"));
+
+        QCOMPARE(m_model->data(m_model->index(0), role("sensitive")).toBool(), false);
+        QCOMPARE(m_model->data(m_model->index(0), role("isToggled")).toBool(), true);
+        QCOMPARE(m_model->data(m_model->index(1), role("isToggled")).toBool(), true);
+
+        // nothing left to flush
+        QTest::qWait(10);
+        QCOMPARE(changed.count(), 0);
+    }
+
+    /*
+     * Test which decoded attributes of a row are dropped for a notified
+     * property of its menu item
+     */
+    void testRowInvalidation()
+    {
+        QVector<int> roles;
+        QVERIFY(UnityMenuModelRow::rolesForProperty("label", &roles));
+        QCOMPARE(roles, QVector<int>() << LabelRole);
+
+        roles.clear();
+        QVERIFY(UnityMenuModelRow::rolesForProperty("role", &roles));
+        QCOMPARE(roles, QVector<int>() << IsCheckRole << IsRadioRole);
+
+        // properties no role depends on
+        roles.clear();
+        QVERIFY(!UnityMenuModelRow::rolesForProperty("visible", &roles));
+        QVERIFY(!UnityMenuModelRow::rolesForProperty("submenu-shown", &roles));
+
+        // unknown properties may change anything
+        roles.clear();
+        QVERIFY(UnityMenuModelRow::rolesForProperty("x-unknown", &roles));
+        QVERIFY(roles.isEmpty());
+
+        UnityMenuModelRow row;
+        const quint8 all = UnityMenuModelRow::Label | UnityMenuModelRow::Icon |
+                           UnityMenuModelRow::Type | UnityMenuModelRow::HasSubmenu;
+        row.cached = all;
+
+        roles.clear();
+        UnityMenuModelRow::rolesForProperty("sensitive", &roles);
+        row.invalidate(roles);
+        QCOMPARE(row.cached, all);
+
+        roles.clear();
+        UnityMenuModelRow::rolesForProperty("icon", &roles);
+        row.invalidate(roles);
+        QCOMPARE(row.cached, quint8(all & ~UnityMenuModelRow::Icon));
+
+        roles.clear();
+        UnityMenuModelRow::rolesForProperty("has-submenu", &roles);
+        row.invalidate(roles);
+        QCOMPARE(row.cached, quint8(UnityMenuModelRow::Label | UnityMenuModelRow::Type));
+
+        row.invalidate(QVector<int>());
+        QCOMPARE(row.cached, quint8(0));
+    }
+
+    /*
+     * Test if the icon of a row is resolved again after the icon theme changed
+     */
+    void testIconThemeChange()
+    {
+        QTemporaryDir themes;
+        QVERIFY(themes.isValid());
+
+        QDir dir(themes.path());
+        QVERIFY(dir.mkpath("testtheme/16x16"));
+        QFile index(dir.filePath("testtheme/index.theme"));
+        QVERIFY(index.open(QIODevice::WriteOnly));
+        index.write("[Icon Theme]\nName=testtheme\nDirectories=16x16\n\n[16x16]\nSize=16\n");
+        index.close();
+        QImage image(16, 16, QImage::Format_ARGB32);
+        image.fill(Qt::red);
+        QVERIFY(image.save(dir.filePath("testtheme/16x16/test-icon.png")));
+
+        const QStringList searchPaths = QIcon::themeSearchPaths();
+        const QString themeName = QIcon::themeName();
+        QIcon::setThemeSearchPaths(QStringList() << themes.path());
+        QIcon::setThemeName("testtheme");
+
+        m_menu->addIcon("Icon", "test-icon");
+        m_menu->track();
+
+        QCOMPARE(m_model->data(m_model->index(0), role("icon")).toString(), QString("image://theme/test-icon"));
+
+        QIcon::setThemeName("missingtheme");
+        QCOMPARE(m_model->data(m_model->index(0), role("icon")).toString(), QString());
+
+        QIcon::setThemeName("testtheme");
+        QCOMPARE(m_model->data(m_model->index(0), role("icon")).toString(), QString("image://theme/test-icon"));
+
+        QIcon::setThemeSearchPaths(searchPaths);
+        QIcon::setThemeName(themeName);
+    }
+
+    /*
+     * Test if extended attributes are loaded with the types of the schema
+     * they were asked for, whether the schema was compiled before or not
+     */
+    void testExtendedAttributes()
+    {
+        GMenuItem *item = g_menu_item_new("Slider", NULL);
+        g_menu_item_set_attribute(item, "x-canonical-type", "s", "com.canonical.slider");
+        g_menu_item_set_attribute(item, "x-min-value", "i", 1);
+        g_menu_item_set_attribute(item, "x-max-value", "i", 10);
+        g_menu_item_set_attribute(item, "x-title", "s", "Volume");
+        m_menu->addItem(item);
+        m_menu->track();
+
+        QVariantMap schema;
+        schema["x-min-value"] = "int";
+        schema["x-max-value"] = "int";
+
+        QVERIFY(m_model->loadExtendedAttributes(0, schema));
+        QVariantMap ext = m_model->data(m_model->index(0), role("ext")).toMap();
+        QCOMPARE(ext.size(), 2);
+        QCOMPARE(ext.value("minValue"), QVariant(1));
+        QCOMPARE(ext.value("maxValue"), QVariant(10));
+
+        // same names, other types
+        QVariantMap strings;
+        strings["x-min-value"] = "string";
+        strings["x-max-value"] = "string";
+        QVERIFY(m_model->loadExtendedAttributes(0, strings));
+        QVERIFY(m_model->data(m_model->index(0), role("ext")).toMap().isEmpty());
+
+        // compiled before, built again from scratch
+        QVariantMap again;
+        again["x-max-value"] = "int";
+        again["x-min-value"] = "int";
+        QVERIFY(m_model->loadExtendedAttributes(0, again));
+        QCOMPARE(m_model->data(m_model->index(0), role("ext")).toMap(), ext);
+
+        // push the schema out of the compiled ones and load it once more
+        for (int i = 0; i < 20; ++i) {
+            QVariantMap other;
+            other[QString("x-value-%1").arg(i)] = "int";
+            m_model->loadExtendedAttributes(0, other);
+        }
+        QVERIFY(m_model->loadExtendedAttributes(0, schema));
+        QCOMPARE(m_model->data(m_model->index(0), role("ext")).toMap(), ext);
+
+        QVariantMap title;
+        title["x-title"] = "string";
+        m_model->registerExtendedAttributes("com.canonical.slider", title);
+        ext = m_model->data(m_model->index(0), role("ext")).toMap();
+        QCOMPARE(ext.size(), 1);
+        QCOMPARE(ext.value("title"), QVariant("Volume"));
+    }
+
+    /*
+     * Test if turning coalescing off emits every change as it happens
+     */
+    void testUncoalescedDataChanges()
+    {
+        GSimpleAction *check = m_menu->addCheck("Check", "check");
+        m_menu->track();
+
+        QSignalSpy switched(m_model, SIGNAL(coalesceDataChangesChanged(bool)));
+        QSignalSpy changed(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)));
+
+        // a pending change is flushed when coalescing is turned off
+        g_simple_action_set_enabled(check, FALSE);
+        QCOMPARE(changed.count(), 0);
+
+        m_model->setProperty("coalesceDataChanges", false);
+        QCOMPARE(m_model->coalesceDataChanges(), false);
+        QCOMPARE(switched.count(), 1);
+        QCOMPARE(changed.count(), 1);
+        QCOMPARE(changed.takeFirst().at(2).value<QVector<int> >(), QVector<int>() << role("sensitive"));
+
+        g_simple_action_set_enabled(check, TRUE);
+        QCOMPARE(changed.count(), 1);
+        QCOMPARE(changed.takeFirst().at(2).value<QVector<int> >(), QVector<int>() << role("sensitive"));
+
+        g_simple_action_set_state(check, g_variant_new_boolean(TRUE));
+        QCOMPARE(changed.count(), 2);
+
+        QTest::qWait(10);
+        QCOMPARE(changed.count(), 2);
+
+        m_model->setCoalesceDataChanges(false);
+        QCOMPARE(switched.count(), 1);
+    }
+};
+
+QTEST_MAIN(UnityMenuModelTest)
+
+#include "unitymenumodeltest.moc"